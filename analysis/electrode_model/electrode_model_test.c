@@ -0,0 +1,157 @@
+/*
+ * File: electrode_model_test.c
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Host test of the electrode model in ct_electrode_model.h
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Usage: electrode_model_test
+ * 
+ * Checks ct_electrode_model_count() against the relation in ct_electrode_model.h: the count is inversely proportional to the capacitance,
+ * proportional to ISOURCE and to the window, and the noise is bounded by noise_counts and reproducible from the seed. Exits with 1 if any
+ * case fails.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cap_touch/ct_electrode_model.h"
+
+#define HF_WINDOW_TICKS 499
+#define LF_WINDOW_TICKS 4
+
+static int _failed = 0;
+
+#define EXPECT(cond, ...) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "line %d: ", __LINE__); \
+        fprintf(stderr, __VA_ARGS__); \
+        fprintf(stderr, "\n"); \
+        _failed++; \
+    } \
+} while (0)
+
+/* a default model without noise */
+static struct ct_electrode_model _model(void) {
+    struct ct_electrode_model m = CT_ELECTRODE_MODEL_DEFAULT;
+    m.noise_counts = 0;
+    return m;
+}
+
+/* within 1 count of rounding */
+static bool _near(uint32_t value, uint64_t expected) {
+    return value + 1 >= expected && value <= expected + 1;
+}
+
+/* the rounding of the reference count is scaled up by factor */
+static bool _near_scaled(uint32_t value, uint32_t reference, uint32_t factor) {
+    return value + factor >= (uint64_t)reference * factor && value <= (uint64_t)reference * factor + factor;
+}
+
+static void _test_nominal(void) {
+    struct ct_electrode_model m = _model();
+    const uint32_t count = ct_electrode_model_count(&m, HF_WINDOW_TICKS, 0);
+    // 499 / 32768 s * 2.5 uA / (20 pF * 25 / 64 * 3 V)
+    EXPECT(_near(count, 1625), "nominal HF count %u", count);
+    const uint32_t lf = ct_electrode_model_count(&m, LF_WINDOW_TICKS, 0);
+    EXPECT(_near(lf, 13), "nominal LF count %u", lf);
+}
+
+static void _test_capacitance(void) {
+    struct ct_electrode_model m = _model();
+    const uint32_t count = ct_electrode_model_count(&m, HF_WINDOW_TICKS, 0);
+    uint32_t prev = count;
+    for (uint32_t touch_ff = 1000; touch_ff <= 20000; touch_ff += 1000) {
+        const uint32_t touched = ct_electrode_model_count(&m, HF_WINDOW_TICKS, touch_ff);
+        EXPECT(touched < prev, "count %u at %u fF touch not below %u", touched, touch_ff, prev);
+        EXPECT(_near(touched, ((uint64_t)count * m.capacitance_ff + (m.capacitance_ff + touch_ff) / 2) / (m.capacitance_ff + touch_ff)),
+            "count %u at %u fF touch not inversely proportional", touched, touch_ff);
+        prev = touched;
+    }
+
+    // the touch adds to the electrode capacitance
+    struct ct_electrode_model double_c = _model();
+    double_c.capacitance_ff *= 2;
+    EXPECT(ct_electrode_model_count(&double_c, HF_WINDOW_TICKS, 0) == ct_electrode_model_count(&m, HF_WINDOW_TICKS, m.capacitance_ff),
+        "touch capacitance differs from electrode capacitance");
+    EXPECT(_near(ct_electrode_model_count(&double_c, HF_WINDOW_TICKS, 0), count / 2), "double capacitance not half count");
+}
+
+static void _test_isource(void) {
+    // COMP ISOURCE settings 2.5, 5 and 10 uA
+    struct ct_electrode_model m = _model();
+    const uint32_t count = ct_electrode_model_count(&m, HF_WINDOW_TICKS, 0);
+    for (uint32_t factor = 2; factor <= 4; factor *= 2) {
+        m.isource_na = 2500 * factor;
+        const uint32_t scaled = ct_electrode_model_count(&m, HF_WINDOW_TICKS, 0);
+        EXPECT(_near_scaled(scaled, count, factor), "count %u at %u nA, expected %u", scaled, m.isource_na, count * factor);
+    }
+
+    // wider thresholds or higher VDD take longer per crossing
+    m = _model();
+    m.th_up = 55;
+    EXPECT(_near(ct_electrode_model_count(&m, HF_WINDOW_TICKS, 0), count / 2), "double threshold span not half count");
+    m = _model();
+    m.th_up = m.th_down;
+    EXPECT(ct_electrode_model_count(&m, HF_WINDOW_TICKS, 0) == 0, "zero threshold span not 0");
+}
+
+static void _test_window(void) {
+    struct ct_electrode_model m = _model();
+    const uint32_t count = ct_electrode_model_count(&m, 100, 0);
+    EXPECT(_near_scaled(ct_electrode_model_count(&m, 400, 0), count, 4), "count not proportional to window");
+    EXPECT(ct_electrode_model_count(&m, 0, 0) == 0, "empty window not 0");
+}
+
+static void _test_noise(void) {
+    struct ct_electrode_model clean = _model();
+    const uint32_t count = ct_electrode_model_count(&clean, HF_WINDOW_TICKS, 0);
+
+    struct ct_electrode_model a = CT_ELECTRODE_MODEL_DEFAULT, b = CT_ELECTRODE_MODEL_DEFAULT;
+    a.noise_counts = b.noise_counts = 10;
+    int64_t sum = 0;
+    bool spread = false;
+    for (int i = 0; i < 10000; i++) {
+        const uint32_t va = ct_electrode_model_count(&a, HF_WINDOW_TICKS, 0);
+        const uint32_t vb = ct_electrode_model_count(&b, HF_WINDOW_TICKS, 0);
+        EXPECT(va == vb, "noise not reproducible at %d", i);
+        EXPECT(va + a.noise_counts >= count && va <= count + a.noise_counts, "noise %d outside bound at %d", (int)va - (int)count, i);
+        spread |= va != count;
+        sum += (int64_t)va - count;
+    }
+    EXPECT(spread, "no noise added");
+    EXPECT(llabs(sum) < 10000 / 10, "noise mean %.2f", sum / 10000.0);
+}
+
+int main(void) {
+    _test_nominal();
+    _test_capacitance();
+    _test_isource();
+    _test_window();
+    _test_noise();
+    printf("%s\n", _failed ? "FAILED" : "ok");
+    return _failed ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * File: filter_bench.c
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Host benchmark of the cap touch filter chain against recorded logs
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/** Runs the raw samples (first column) of the bt_log recordings through src/cap_touch/ct_filter.h, and reports per file:
+ * - host time per sample, only useful for relative comparison between configurations
+ * - noise as mean absolute difference between consecutive values, for raw and filtered
+ * - delay from the largest sustained raw step until the filtered value crosses its midpoint, in raw samples and ms. -1 if it never does, or if
+ *   the log has no step of at least STEP_NOISE_MIN times the raw noise (the voltage logs are untouched).
+ *   The step is where the medians of the STEP_WINDOW raw samples before and after differ most, such that single sample spikes are not taken as steps.
+ *   An output is counted at the raw sample which completes it, so decimation adds to the delay
+ * 
+ * The filter chain is selected with the same CT_FILTER_* macros as on target, see Makefile.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cap_touch/ct_filter.h"
+
+#define SAMPLES_MAX 16384
+#define BENCH_REPEAT 200
+#define STEP_WINDOW 8
+#define STEP_NOISE_MIN 4
+#define SAMPLE_PERIOD_MS (4000 * 1000.0 / 32768) // RTC_TICKS_RESET_HIGH_FREQUENCY in ct_current_oscillate.c
+
+static size_t _log_read(const char *path, uint16_t *buf, size_t size) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return 0;
+    }
+
+    size_t n = 0;
+    char line[128];
+    while (n < size && fgets(line, sizeof(line), f) != NULL) {
+        unsigned int lo, hi;
+        if (sscanf(line, "%2x %2x", &lo, &hi) != 2 || strlen(line) < 5 || line[2] != ' ') {
+            continue; // "Notifications started." and similar
+        }
+        buf[n++] = (uint16_t)(lo | hi << 8);
+    }
+    fclose(f);
+    return n;
+}
+
+static double _noise(const uint16_t *buf, size_t size) {
+    if (size < 2) return 0;
+    uint64_t sum = 0;
+    for (size_t i = 1; i < size; i++) {
+        sum += buf[i] > buf[i - 1] ? buf[i] - buf[i - 1] : buf[i - 1] - buf[i];
+    }
+    return (double)sum / (size - 1);
+}
+
+static int _u16_cmp(const void *a, const void *b) {
+    return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+static int _median(const uint16_t *buf) {
+    uint16_t sorted[STEP_WINDOW];
+    memcpy(sorted, buf, sizeof(sorted));
+    qsort(sorted, STEP_WINDOW, sizeof(sorted[0]), _u16_cmp);
+    return (sorted[STEP_WINDOW / 2 - 1] + sorted[STEP_WINDOW / 2]) / 2;
+}
+
+/* index of the first raw sample after the largest sustained step, 0 if there is none larger than step_min */
+static size_t _step_find(const uint16_t *raw, size_t n, int step_min, int *mid, int *rising) {
+    size_t step_idx = 0;
+    int step_size = step_min;
+    for (size_t i = STEP_WINDOW; i + STEP_WINDOW <= n; i++) {
+        const int before = _median(raw + i - STEP_WINDOW);
+        const int after = _median(raw + i);
+        if (abs(after - before) > step_size) {
+            step_size = abs(after - before);
+            step_idx = i;
+            *mid = (before + after) / 2;
+            *rising = after > before;
+        }
+    }
+    return step_idx;
+}
+
+int main(int argc, char **argv) {
+    static uint16_t raw[SAMPLES_MAX];
+    static uint16_t out[SAMPLES_MAX];
+
+    printf("median %d, decimate 2^%d, iir %d/256, slew %d\n", CT_FILTER_MEDIAN_SIZE, CT_FILTER_DECIMATE_LOG2, CT_FILTER_IIR_FACTOR, CT_FILTER_SLEW_MAX);
+    printf("%-60s %8s %10s %10s %10s %8s %9s\n", "file", "samples", "ns/sample", "noise_raw", "noise_out", "delay", "delay_ms");
+
+    for (int arg = 1; arg < argc; arg++) {
+        const size_t n_raw = _log_read(argv[arg], raw, SAMPLES_MAX);
+        if (n_raw == 0) continue;
+
+        size_t n_out = 0;
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (int r = 0; r < BENCH_REPEAT; r++) {
+            struct ct_filter filter = {0};
+            n_out = 0;
+            for (size_t i = 0; i < n_raw; i++) {
+                if (ct_filter_process(&filter, raw[i])) {
+                    out[n_out++] = filter.value;
+                }
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        const double ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / ((double)n_raw * BENCH_REPEAT);
+
+        // largest sustained step in raw, and how many raw samples the output takes to cross its midpoint
+        int mid = 0, rising = 0;
+        const size_t step_idx = _step_find(raw, n_raw, (int)(STEP_NOISE_MIN * _noise(raw, n_raw)), &mid, &rising);
+        const size_t ratio = n_raw / (n_out ? n_out : 1); // raw samples per output
+        long delay = -1;
+        for (size_t i = 0; step_idx > 0 && i < n_out; i++) {
+            const size_t completed = (i + 1) * ratio - 1; // raw sample completing output i
+            if (completed < step_idx) continue;
+            if (rising ? out[i] >= mid : out[i] <= mid) {
+                delay = (long)(completed - step_idx);
+                break;
+            }
+        }
+
+        printf("%-60s %8zu %10.1f %10.2f %10.2f %8ld %9.0f\n", argv[arg], n_raw, ns, _noise(raw, n_raw), _noise(out + 8, n_out > 8 ? n_out - 8 : 0),
+            delay, delay < 0 ? -1 : delay * SAMPLE_PERIOD_MS);
+    }
+    return 0;
+}
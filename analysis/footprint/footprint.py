@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+# File: footprint.py
+# Author: Rein Gundersen Bentdal
+# Created: 18.Okt 2026
+# Description: Per module RAM, flash and stack report of a build, with budgets
+#
+# Copyright (c) 2026, Rein Gundersen Bentdal
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+"""Usage: footprint.py --map zephyr.map --src src [--build build] [--budget module ram flash]...
+
+Sums the input sections of the linker map per module. The modules of the application are the directories under src/ (main for
+src/main.c), Zephyr libraries are zephyr:<subsystem> and toolchain libraries toolchain:<library>. A source file name, e.g. bt_log.c,
+is also accepted as a module for budgets. Initialised data counts both as RAM and flash.
+
+With CONFIG_STACK_USAGE, the .su files of the application in the build directory give the largest stack frame of each module.
+The worst case stack of a thread is the sum along its deepest call chain, so this is a lower bound. The runtime high-water
+marks are logged by the thread analyzer in debug.conf.
+
+Each --budget is the RAM and flash in bytes a module may use, 0 is no budget. "total" is the whole image.
+Exits with 1 if a budget is exceeded.
+"""
+
+import argparse
+import os
+import re
+import sys
+from collections import defaultdict
+
+_REGION = re.compile(r"^(\S+)\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)")
+_OUTPUT = re.compile(r"^([^\s*]\S*)(?:\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)(?:\s+load address\s+0x[0-9a-fA-F]+)?)?\s*$")
+_OUTPUT_CONT = re.compile(r"^\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)(?:\s+load address\s+0x[0-9a-fA-F]+)?\s*$")
+_INPUT = re.compile(r"^ ([^\s*]\S*)(?:\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)\s+(\S.*))?\s*$")
+_INPUT_CONT = re.compile(r"^\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)\s+(\S.*?)\s*$")
+_ARCHIVE = re.compile(r"^(?:.*/)?lib([^/]*)\.a\(([^)]*)\)$")
+
+
+def _source_modules(src):
+    """Source file name -> module, from the directories under src."""
+    modules = {}
+    for root, _, files in os.walk(src):
+        rel = os.path.relpath(root, src)
+        for name in files:
+            if name.endswith(".c"):
+                modules[name] = "main" if rel == "." else rel.split(os.sep)[0]
+    return modules
+
+
+def _module(path, sources):
+    """Module and source file of a map file column. Libraries of the build have relative paths, toolchain libraries absolute."""
+    match = _ARCHIVE.match(path)
+    if not match:
+        return "other", None
+    library, obj = match.groups()
+    source = obj[:-len(".obj")] if obj.endswith(".obj") else obj
+    if library == "app":
+        return sources.get(source, "app"), source
+    if not os.path.isabs(path):
+        parts = library.split("__")
+        if parts[0] in ("subsys", "modules") and len(parts) > 1:
+            parts = parts[1:]
+        return "zephyr:" + parts[0], None
+    return "toolchain:" + library, None
+
+
+def _regions(lines):
+    """Address ranges of the RAM and flash memory regions."""
+    regions = {"ram": [], "flash": []}
+    inside = False
+    for line in lines:
+        if line.startswith("Memory Configuration"):
+            inside = True
+        elif line.startswith("Linker script and memory map"):
+            break
+        elif inside:
+            match = _REGION.match(line)
+            if match and match.group(1) != "*default*":
+                start, size = int(match.group(2), 16), int(match.group(3), 16)
+                kind = "ram" if "RAM" in match.group(1).upper() else "flash" if "FLASH" in match.group(1).upper() else None
+                if kind:
+                    regions[kind].append((start, start + size))
+    return regions
+
+
+def _inside(address, ranges):
+    return any(start <= address < end for start, end in ranges)
+
+
+def parse_map(path, sources):
+    """module -> [ram, flash], also for each application source file."""
+    with open(path) as f:
+        lines = f.read().splitlines()
+    regions = _regions(lines)
+    usage = defaultdict(lambda: [0, 0])
+
+    start = next((i for i, line in enumerate(lines) if line.startswith("Linker script and memory map")), len(lines))
+    loaded = False
+    pending_output = pending_input = False
+    for line in lines[start + 1:]:
+        if pending_output:
+            pending_output = False
+            match = _OUTPUT_CONT.match(line)
+            if match:
+                loaded = "load address" in line
+                continue
+        if pending_input:
+            pending_input = False
+            match = _INPUT_CONT.match(line)
+            if match:
+                address, size, obj = int(match.group(1), 16), int(match.group(2), 16), match.group(3)
+                _add(usage, sources, regions, loaded, address, size, obj)
+                continue
+
+        match = _OUTPUT.match(line)
+        if match:
+            pending_output = match.group(2) is None
+            loaded = "load address" in line
+            continue
+        match = _INPUT.match(line)
+        if match:
+            if match.group(2) is None:
+                pending_input = True
+            else:
+                _add(usage, sources, regions, loaded, int(match.group(2), 16), int(match.group(3), 16), match.group(4))
+    return usage
+
+
+def _add(usage, sources, regions, loaded, address, size, obj):
+    if size == 0:
+        return
+    ram = _inside(address, regions["ram"])
+    flash = not ram and _inside(address, regions["flash"]) or ram and loaded
+    if not ram and not flash:
+        return
+    module, source = _module(obj.strip(), sources)
+    for key in (module, source, "total"):
+        if key:
+            usage[key][0] += size if ram else 0
+            usage[key][1] += size if flash else 0
+
+
+def parse_stack(build, sources):
+    """module -> largest static stack frame of the application, from the .su files."""
+    stack = defaultdict(int)
+    for root, _, files in os.walk(build):
+        if "app.dir" not in root.split(os.sep):
+            continue
+        for name in files:
+            if not name.endswith(".su"):
+                continue
+            source = name[:-len(".su")]
+            with open(os.path.join(root, name)) as f:
+                for line in f:
+                    fields = line.split("\t")
+                    if len(fields) >= 2 and fields[1].strip().isdigit():
+                        frame = int(fields[1])
+                        for key in (sources.get(source, "app"), source):
+                            stack[key] = max(stack[key], frame)
+    return stack
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Per module RAM, flash and stack report of a build, with budgets")
+    parser.add_argument("--map", required=True, help="linker map, build/zephyr/zephyr.map")
+    parser.add_argument("--src", required=True, help="application source directory")
+    parser.add_argument("--build", help="build directory with the .su files of CONFIG_STACK_USAGE")
+    parser.add_argument("--budget", nargs=3, action="append", default=[], metavar=("MODULE", "RAM", "FLASH"))
+    args = parser.parse_args()
+
+    sources = _source_modules(args.src)
+    usage = parse_map(args.map, sources)
+    stack = parse_stack(args.build, sources) if args.build else {}
+
+    print(f"{'module':<24}{'ram':>8}{'flash':>8}{'stack':>8}")
+    modules = sorted((key for key in usage if not key.endswith(".c") and key != "total"),
+                     key=lambda key: (key not in sources.values(), -usage[key][1]))
+    for key in modules + ["total"]:
+        frame = str(stack[key]) if key in stack else "-"
+        print(f"{key:<24}{usage[key][0]:>8}{usage[key][1]:>8}{frame:>8}")
+
+    exceeded = False
+    for module, ram, flash in args.budget:
+        used = usage.get(module, [0, 0])
+        for kind, budget, value in (("RAM", int(ram), used[0]), ("flash", int(flash), used[1])):
+            if budget and value > budget:
+                print(f"footprint: {module} uses {value} B {kind}, budget is {budget} B", file=sys.stderr)
+                exceeded = True
+    return 1 if exceeded else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,400 @@
+/*
+ * File: param_sweep.c
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Parallel parameter sweep of the cap touch thresholds over recorded datasets
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Replays the recorded HF samples through the same filter and transform as the target, for every combination of activate margin and IIR factor
+ * in the grid (or N random points with --random N), spread over all CPU cores. Each configuration is scored on:
+ * - latency: mean number of samples from the start of a touch block until the output is above 0, a missed touch counts as the full block
+ * - false positive rate: fraction of samples in no touch blocks with output above 0
+ * - HF residency: fraction of all samples spent in _STATE_HIGH_FREQUENCY
+ * 
+ * The Pareto optimal configurations are printed, and written to a header together with the selected configuration (lowest normalised sum of
+ * the three scores). Enable CONFIG_CAP_TOUCH_TUNING_GENERATED to build with the header copied to src/cap_touch/ct_tuning.h.
+ * 
+ * Datasets are given as <file>[:<offset>]. With an offset, the file is split into blocks on "Notifications started.", and block i is at finger
+ * distance i - offset mm, where distance <= 0 is a touch (same as analysis/artificial_finger/analyze.ipynb). Without an offset, the whole file is no touch.
+ * Binary recordings (.ctr, see analysis/record) are split on segments, and labelled from the chunk labels.
+ * 
+ * Each dataset is calibrated from its own initial samples, the same way the device calibrates after start: the highest sample of the first
+ * capture period (1 s) and of the second (2 s), and the lower of the two (rank 3 of the 5 point buffer, still holding 3 zeros). The initial samples
+ * are taken from the first no touch block, as the recording device was started without a touch.
+ * 
+ * The saturate margin only shapes the output level above activate. The datasets have no label for the expected level, so it is not swept and
+ * the generated header keeps CT_SATURATE_MARGIN_DEFAULT.
+ * 
+ * The autonomous mode is approximated by scaling the HF samples to the LF window, the real LF samples are noisier.
+*/
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CT_FILTER_MEDIAN_SIZE 0
+#define CT_FILTER_DECIMATE_LOG2 0
+#define CT_FILTER_IIR_FACTOR_RUNTIME
+#define CT_FILTER_SLEW_MAX 0
+#include "cap_touch/ct_filter.h"
+#include "cap_touch/ct_transform.h"
+#include "utils/sorted_index_get.h"
+#include "record/ct_record_reader.h"
+
+/* same operation parameters as ct_current_oscillate.c */
+#define RTC_TICKS_SAMPLE 4
+#define RTC_TICKS_SAMPLE_HF 500
+#define RTC_TICKS_RESET 4000
+#define CALIBRATION_SAMPLES(sec) ((sec) * 32768 / RTC_TICKS_RESET)
+
+#define BLOCKS_MAX 4096
+#define THREADS_MAX 256
+
+struct block {
+    uint16_t *samples;
+    size_t size;
+    bool touch;
+    uint32_t calibration_point; // LF count with no touch, of the dataset
+};
+
+struct config {
+    uint8_t activate_margin;    // fixed8
+    uint8_t iir_factor;         // fixed8
+    double latency;
+    double false_positive;
+    double hf_residency;
+    bool pareto;
+};
+
+static struct block _blocks[BLOCKS_MAX];
+static size_t _block_count;
+
+static struct config *_configs;
+static size_t _config_count;
+static size_t _config_next;
+static pthread_mutex_t _config_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void _block_add(uint16_t *samples, size_t size, bool touch) {
+    if (size == 0 || _block_count >= BLOCKS_MAX) {
+        free(samples);
+        return;
+    }
+    _blocks[_block_count++] = (struct block){.samples = samples, .size = size, .touch = touch};
+}
+
+static int _dataset_read_ctr(const char *path) {
+    struct ct_record_reader reader;
+    if (ct_record_open(&reader, path)) {
+        fprintf(stderr, "%s: not a valid recording\n", path);
+        return -1;
+    }
+    const bool labelled = reader.header->flags & CT_RECORD_FLAG_LABEL_DISTANCE;
+
+    struct ct_record_chunk chunk;
+    uint16_t *samples = NULL;
+    size_t size = 0;
+    int segment = -1;
+    bool touch = false;
+    while (ct_record_chunk_next(&reader, &chunk)) {
+        if (chunk.header->segment != segment) {
+            if (samples) _block_add(samples, size, touch);
+            samples = NULL;
+            size = 0;
+            segment = chunk.header->segment;
+            touch = labelled && chunk.header->label <= 0;
+        }
+        samples = realloc(samples, (size + chunk.header->rows) * sizeof(uint16_t));
+        memcpy(samples + size, chunk.count[0], chunk.header->rows * sizeof(uint16_t));
+        size += chunk.header->rows;
+    }
+    if (samples) _block_add(samples, size, touch);
+    ct_record_close(&reader);
+    return 0;
+}
+
+static int _dataset_read(const char *arg) {
+    const size_t length = strlen(arg);
+    if (length > 4 && !strcmp(arg + length - 4, ".ctr")) {
+        return _dataset_read_ctr(arg);
+    }
+
+    char path[512];
+    strncpy(path, arg, sizeof(path) - 1);
+    path[sizeof(path) - 1] = 0;
+    char *offset_str = strrchr(path, ':');
+    const bool has_offset = offset_str != NULL;
+    const int offset = has_offset ? atoi(offset_str + 1) : 0;
+    if (has_offset) *offset_str = 0;
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    char line[128];
+    int block_idx = -1;
+    size_t size = 0, capacity = 1024;
+    uint16_t *samples = malloc(capacity * sizeof(uint16_t));
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (!strncmp(line, "Notifications started.", 22)) {
+            if (has_offset) {
+                if (block_idx >= 0) _block_add(samples, size, block_idx - offset <= 0);
+                else free(samples);
+                samples = malloc(capacity * sizeof(uint16_t));
+                size = 0;
+            }
+            block_idx++;
+            continue;
+        }
+        unsigned int lo, hi;
+        if (line[2] != ' ' || sscanf(line, "%2x %2x", &lo, &hi) != 2) continue;
+        if (size == capacity) {
+            capacity *= 2;
+            samples = realloc(samples, capacity * sizeof(uint16_t));
+        }
+        samples[size++] = (uint16_t)(lo | hi << 8);
+    }
+    fclose(f);
+    _block_add(samples, size, has_offset && block_idx - offset <= 0);
+    return 0;
+}
+
+static uint16_t _samples_max(const uint16_t *samples, size_t size) {
+    uint16_t max = 0;
+    for (size_t i = 0; i < size; i++) max = samples[i] > max ? samples[i] : max;
+    return max;
+}
+
+/* calibrates the blocks from first on, which are one dataset */
+static int _dataset_calibrate(const char *path, size_t first) {
+    const struct block *initial = NULL;
+    for (size_t i = first; i < _block_count && initial == NULL; i++) {
+        if (!_blocks[i].touch) initial = &_blocks[i];
+    }
+    if (initial == NULL || initial->size < CALIBRATION_SAMPLES(1) + CALIBRATION_SAMPLES(2)) {
+        fprintf(stderr, "%s: no no touch block to calibrate from\n", path);
+        return -1;
+    }
+
+    const uint16_t first_max = _samples_max(initial->samples, CALIBRATION_SAMPLES(1));
+    const uint16_t second_max = _samples_max(initial->samples + CALIBRATION_SAMPLES(1), CALIBRATION_SAMPLES(2));
+    const uint16_t hf = first_max < second_max ? first_max : second_max;
+    for (size_t i = first; i < _block_count; i++) {
+        _blocks[i].calibration_point = (uint32_t)hf * RTC_TICKS_SAMPLE / RTC_TICKS_SAMPLE_HF;
+    }
+    return 0;
+}
+
+static void _config_evaluate(struct config *c) {
+    size_t samples = 0, samples_hf = 0, samples_no_touch = 0, false_positive = 0, touch_blocks = 0;
+    double latency = 0;
+
+    for (size_t b = 0; b < _block_count; b++) {
+        const struct block *block = &_blocks[b];
+        const struct ct_counter_region region = ct_counter_region_calc(block->calibration_point, c->activate_margin, CT_SATURATE_MARGIN_DEFAULT);
+        struct ct_filter filter = {.iir_factor = c->iir_factor};
+        bool state_hf = false;
+        size_t detected = block->size;
+
+        for (size_t i = 0; i < block->size; i++) {
+            const uint16_t sample = block->samples[i];
+            uint8_t output = 0;
+            if (!state_hf) {
+                // autonomous mode, wakes when the LF count is below activate. The sample itself is discarded
+                state_hf = (uint32_t)sample * RTC_TICKS_SAMPLE / RTC_TICKS_SAMPLE_HF < region.activate;
+                if (state_hf && filter.value == 0) filter.value = sample;
+            } else {
+                samples_hf++;
+                (void)ct_filter_process(&filter, sample);
+                const int32_t transformed = ct_transform(filter.value, &region, RTC_TICKS_SAMPLE, RTC_TICKS_SAMPLE_HF, 0);
+                output = transformed > 0 ? transformed : 0;
+                state_hf = output > 0;
+            }
+
+            if (output > 0 && detected == block->size) detected = i;
+            if (!block->touch) {
+                samples_no_touch++;
+                false_positive += output > 0;
+            }
+            samples++;
+        }
+
+        if (block->touch) {
+            latency += detected;
+            touch_blocks++;
+        }
+    }
+
+    c->latency = touch_blocks ? latency / touch_blocks : 0;
+    c->false_positive = samples_no_touch ? (double)false_positive / samples_no_touch : 0;
+    c->hf_residency = samples ? (double)samples_hf / samples : 0;
+}
+
+static void *_worker(void *arg) {
+    (void)arg;
+    while (true) {
+        pthread_mutex_lock(&_config_lock);
+        const size_t idx = _config_next++;
+        pthread_mutex_unlock(&_config_lock);
+        if (idx >= _config_count) return NULL;
+        _config_evaluate(&_configs[idx]);
+    }
+}
+
+static void _configs_grid(void) {
+    _config_count = 0;
+    for (int activate = 50; activate <= 95; activate += 5) {
+        for (int iir = 0; iir <= 90; iir += 10) {
+            _config_count++;
+        }
+    }
+    _configs = calloc(_config_count, sizeof(struct config));
+    size_t i = 0;
+    for (int activate = 50; activate <= 95; activate += 5) {
+        for (int iir = 0; iir <= 90; iir += 10) {
+            _configs[i++] = (struct config){
+                .activate_margin = CT_FIXED8_PERCENT(activate),
+                .iir_factor = CT_FIXED8_PERCENT(iir),
+            };
+        }
+    }
+}
+
+static void _configs_random(size_t count) {
+    _config_count = count;
+    _configs = calloc(_config_count, sizeof(struct config));
+    uint32_t rng = 0xACE1u;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t values[2];
+        for (int v = 0; v < 2; v++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            values[v] = rng % 250;
+        }
+        _configs[i] = (struct config){
+            .activate_margin = 100 + values[0] % 150,
+            .iir_factor = values[1],
+        };
+    }
+}
+
+static bool _dominates(const struct config *a, const struct config *b) {
+    return a->latency <= b->latency && a->false_positive <= b->false_positive && a->hf_residency <= b->hf_residency &&
+        (a->latency < b->latency || a->false_positive < b->false_positive || a->hf_residency < b->hf_residency);
+}
+
+static bool _equal(const struct config *a, const struct config *b) {
+    return a->latency == b->latency && a->false_positive == b->false_positive && a->hf_residency == b->hf_residency;
+}
+
+static double _score(const struct config *c, const struct config *max) {
+    return (max->latency ? c->latency / max->latency : 0) + (max->false_positive ? c->false_positive / max->false_positive : 0) +
+        (max->hf_residency ? c->hf_residency / max->hf_residency : 0);
+}
+
+static int _header_write(const char *path, const struct config *selected) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    fprintf(f, "/* Generated by analysis/param_sweep, do not edit */\n\n");
+    fprintf(f, "/* Pareto optimal configurations, fixed8 values\n");
+    fprintf(f, " * activate iir   latency[samples] false_positive hf_residency\n");
+    for (size_t i = 0; i < _config_count; i++) {
+        const struct config *c = &_configs[i];
+        if (!c->pareto) continue;
+        fprintf(f, " * %8u %4u   %16.2f %14.4f %12.4f%s\n", c->activate_margin, c->iir_factor, c->latency,
+            c->false_positive, c->hf_residency, c == selected ? "  <- selected" : "");
+    }
+    fprintf(f, " */\n\n#pragma once\n\n");
+    fprintf(f, "#define CT_ACTIVATE_MARGIN_DEFAULT %u\n", selected->activate_margin);
+    fprintf(f, "#define CT_FILTER_IIR_FACTOR %u\n", selected->iir_factor);
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *header_path = "ct_tuning.h";
+    size_t random_count = 0;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (!strcmp(argv[arg], "--random") && arg + 1 < argc) {
+            random_count = strtoul(argv[++arg], NULL, 10);
+        } else if (!strcmp(argv[arg], "-o") && arg + 1 < argc) {
+            header_path = argv[++arg];
+        } else {
+            fprintf(stderr, "usage: %s [--random N] [-o header] <file>[:<offset>]...\n", argv[0]);
+            return 1;
+        }
+    }
+    for (; arg < argc; arg++) {
+        const size_t first = _block_count;
+        if (_dataset_read(argv[arg]) || _dataset_calibrate(argv[arg], first)) return 1;
+    }
+    if (_block_count == 0) {
+        fprintf(stderr, "no datasets\n");
+        return 1;
+    }
+
+    if (random_count) _configs_random(random_count);
+    else _configs_grid();
+
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = threads < 1 ? 1 : threads > THREADS_MAX ? THREADS_MAX : threads;
+    pthread_t workers[THREADS_MAX];
+    for (long i = 0; i < threads; i++) pthread_create(&workers[i], NULL, _worker, NULL);
+    for (long i = 0; i < threads; i++) pthread_join(workers[i], NULL);
+
+    struct config max = {0};
+    for (size_t i = 0; i < _config_count; i++) {
+        const struct config *c = &_configs[i];
+        max.latency = c->latency > max.latency ? c->latency : max.latency;
+        max.false_positive = c->false_positive > max.false_positive ? c->false_positive : max.false_positive;
+        max.hf_residency = c->hf_residency > max.hf_residency ? c->hf_residency : max.hf_residency;
+    }
+
+    const struct config *selected = NULL;
+    size_t pareto_count = 0;
+    for (size_t i = 0; i < _config_count; i++) {
+        _configs[i].pareto = true;
+        for (size_t j = 0; j < _config_count && _configs[i].pareto; j++) {
+            if (_dominates(&_configs[j], &_configs[i]) || (j < i && _equal(&_configs[j], &_configs[i]))) _configs[i].pareto = false; // keep the first of equal scores
+        }
+        if (!_configs[i].pareto) continue;
+        pareto_count++;
+        if (selected == NULL || _score(&_configs[i], &max) < _score(selected, &max)) selected = &_configs[i];
+    }
+
+    printf("%zu blocks, %zu configurations on %ld threads, %zu pareto optimal\n", _block_count, _config_count, threads, pareto_count);
+    printf("selected: activate %u, iir %u: latency %.2f, false positive %.4f, hf residency %.4f\n", selected->activate_margin,
+        selected->iir_factor, selected->latency, selected->false_positive, selected->hf_residency);
+    return _header_write(header_path, selected) ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * File: position_test.c
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Host test of the slider and wheel position in ct_position.h
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Usage: position_test
+ * 
+ * Feeds pad levels through ct_position_process() and checks the slider ends and midpoint, the interpolation between pads, the wheel wrap
+ * around, the deadband and the touch start and end reports. Exits with 1 if any case fails.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cap_touch/ct_position.h"
+
+static int _failed = 0;
+
+#define EXPECT(cond, ...) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "line %d: ", __LINE__); \
+        fprintf(stderr, __VA_ARGS__); \
+        fprintf(stderr, "\n"); \
+        _failed++; \
+    } \
+} while (0)
+
+/* a touch on a fresh state, returns the position */
+static uint8_t _position_get(uint8_t pads, enum ct_position_type type, const uint8_t *levels) {
+    struct ct_position p = CT_POSITION_INIT(pads, type);
+    const bool changed = ct_position_process(&p, levels);
+    EXPECT(changed && p.touched, "touch start not reported");
+    return p.position;
+}
+
+static void _test_slider(void) {
+    EXPECT(_position_get(4, CT_POSITION_SLIDER, (uint8_t[]){100, 0, 0, 0}) == 0, "slider start not 0");
+    EXPECT(_position_get(4, CT_POSITION_SLIDER, (uint8_t[]){0, 0, 0, 100}) == 255, "slider end not 255");
+    EXPECT(_position_get(4, CT_POSITION_SLIDER, (uint8_t[]){0, 80, 80, 0}) == 128, "slider midpoint not 128");
+    EXPECT(_position_get(2, CT_POSITION_SLIDER, (uint8_t[]){60, 60}) == 128, "two pad slider midpoint not 128");
+
+    // a finger centered on the end pad still couples to its inner neighbour
+    const uint8_t end = _position_get(4, CT_POSITION_SLIDER, (uint8_t[]){100, 30, 0, 0});
+    EXPECT(end > 0 && end < 85 / 2, "slider end with neighbour coupling at %u", end);
+
+    // interpolation is monotonic when the finger moves from pad 1 towards pad 2
+    uint8_t prev = 0;
+    for (int level = 0; level <= 100; level += 10) {
+        const uint8_t position = _position_get(4, CT_POSITION_SLIDER, (uint8_t[]){0, 100, level, 0});
+        EXPECT(position >= prev, "slider not monotonic at level %d: %u after %u", level, position, prev);
+        prev = position;
+    }
+    EXPECT(prev == 128, "slider between pad 1 and 2 at %u", prev);
+
+    struct ct_position p = CT_POSITION_INIT(4, CT_POSITION_SLIDER);
+    EXPECT(!ct_position_process(&p, (uint8_t[]){10, 0, 0, 0}) && !p.touched, "touch below threshold");
+}
+
+static void _test_wheel(void) {
+    EXPECT(_position_get(3, CT_POSITION_WHEEL, (uint8_t[]){100, 0, 0}) == 0, "wheel pad 0 not 0");
+    EXPECT(_position_get(3, CT_POSITION_WHEEL, (uint8_t[]){0, 100, 0}) == 85, "wheel pad 1 not 85");
+    EXPECT(_position_get(4, CT_POSITION_WHEEL, (uint8_t[]){0, 0, 100, 0}) == 128, "wheel pad 2 of 4 not 128");
+
+    // between the last pad and pad 0, interpolated across the wrap around
+    const uint8_t wrap = _position_get(3, CT_POSITION_WHEEL, (uint8_t[]){80, 0, 80});
+    EXPECT(wrap == 213, "wheel between pad 2 and 0 at %u", wrap);
+    const uint8_t before_zero = _position_get(4, CT_POSITION_WHEEL, (uint8_t[]){100, 0, 0, 20});
+    EXPECT(before_zero > 192, "wheel just before pad 0 at %u", before_zero);
+
+    // moving forward over the wrap around gives a positive velocity and no jump back
+    struct ct_position p = CT_POSITION_INIT(4, CT_POSITION_WHEEL);
+    const uint8_t steps[][4] = {{0, 0, 30, 100}, {20, 0, 0, 100}, {100, 0, 0, 100}, {100, 20, 0, 0}, {100, 60, 0, 0}};
+    uint8_t prev = 0;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        EXPECT(ct_position_process(&p, steps[i]), "wheel step %zu not reported", i);
+        if (i > 0) {
+            const int8_t moved = (int8_t)(p.position - prev);
+            EXPECT(moved > 0, "wheel step %zu moved %d", i, moved);
+            EXPECT(p.velocity > 0, "wheel step %zu velocity %d", i, p.velocity);
+        }
+        prev = p.position;
+    }
+}
+
+static void _test_reports(void) {
+    struct ct_position p = CT_POSITION_INIT(4, CT_POSITION_SLIDER);
+    EXPECT(ct_position_process(&p, (uint8_t[]){0, 100, 0, 0}), "touch start not reported");
+    EXPECT(p.velocity == 0 && p.size == 100, "touch start velocity %d, size %u", p.velocity, p.size);
+
+    // within the deadband, the position is kept
+    EXPECT(!ct_position_process(&p, (uint8_t[]){0, 100, 1, 0}), "move within deadband reported");
+    EXPECT(p.position == 85, "position changed within deadband to %u", p.position);
+    EXPECT(ct_position_process(&p, (uint8_t[]){0, 100, 20, 0}), "move outside deadband not reported");
+    EXPECT(p.position > 85 && p.velocity > 0, "position %u, velocity %d after move", p.position, p.velocity);
+
+    EXPECT(ct_position_process(&p, (uint8_t[]){0, 0, 0, 0}), "touch end not reported");
+    EXPECT(!p.touched && p.velocity == 0 && p.size == 0, "state not cleared at touch end");
+    EXPECT(!ct_position_process(&p, (uint8_t[]){0, 0, 0, 0}), "no touch reported twice");
+}
+
+int main(void) {
+    _test_slider();
+    _test_wheel();
+    _test_reports();
+    printf("%s\n", _failed ? "FAILED" : "ok");
+    return _failed ? 1 : 0;
+}
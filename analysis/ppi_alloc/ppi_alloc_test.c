@@ -0,0 +1,204 @@
+/*
+ * File: ppi_alloc_test.c
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Host test of the PPI channel allocator with the allocation order of the cap touch configurations
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Usage: ppi_alloc_test
+ * 
+ * Each scenario replays the ppi_connect() and channel disable order of ct_current_oscillate.c for one configuration, in a child process
+ * because the allocator state is static. Channels disabled right after they are connected must not be handed out again, and every
+ * channel must still connect the event and task it was allocated for. Exits with 1 if any scenario fails.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <zephyr/kernel.h>
+#include "nrf.h"
+#include "utils/ppi_connect.h"
+
+#define CHANNELS 20
+#define CONNECTIONS_MAX 32
+
+NRF_PPI_Type ppi_model;
+
+struct _connection {
+    const char *name;
+    uint32_t channel;
+};
+
+static uint32_t _events[CONNECTIONS_MAX];
+static uint32_t _tasks[CONNECTIONS_MAX];
+static struct _connection _connections[CONNECTIONS_MAX];
+static size_t _connections_num = 0;
+
+/* the register writes the hardware applies to CHEN */
+static void _ppi_sync(void) {
+    NRF_PPI->CHEN = (NRF_PPI->CHEN | NRF_PPI->CHENSET) & ~NRF_PPI->CHENCLR;
+    NRF_PPI->CHENSET = 0;
+    NRF_PPI->CHENCLR = 0;
+}
+
+static uint32_t _connect(const char *name) {
+    if (_connections_num == CONNECTIONS_MAX) {
+        fprintf(stderr, "too many connections\n");
+        exit(1);
+    }
+    const size_t n = _connections_num++;
+    const uint32_t channel = ppi_connect(&_events[n], &_tasks[n]);
+    _ppi_sync();
+    _connections[n] = (struct _connection){.name = name, .channel = channel};
+    return channel;
+}
+
+static void _disable(uint32_t mask) {
+    NRF_PPI->CHENCLR = mask;
+    _ppi_sync();
+}
+
+static uint32_t _group(uint32_t mask) {
+    const uint32_t group = ppi_new_group_find();
+    NRF_PPI->CHG[group] = mask ? mask : 1; // non-zero, such that the group is not found again
+    return group;
+}
+
+/* the steps of ct_current_oscillate.c, by the function doing the allocation */
+
+static void _configure_ppi(void) {
+    (void)_group(0);
+    (void)_group(0);
+    (void)_group(0);
+    static const char *const names[] = {"comp_count", "isr_always_activate", "calibration_lf_compare", "calibration_hf_compare", "comp_start",
+        "pwm_on1", "pwm_on_grp", "pwm_off", "calibration_lf_capture", "calibration_hf_capture", "sample_ready", "rtc_reset"};
+    for (size_t i = 0; i < ARRAY_SIZE(names); i++) {
+        (void)_connect(names[i]);
+    }
+}
+
+static void _configure_radio_coexist(void) {
+    const uint32_t ready = _connect("radio_ready");
+    const uint32_t disabled = _connect("radio_disabled");
+    (void)_group((1 << ready) | (1 << disabled));
+    _disable((1 << ready) | (1 << disabled));
+}
+
+/* left disabled by _period_measure_enable(false) until _STATE_HIGH_FREQUENCY */
+static void _configure_period_timer(void) {
+    const uint32_t start = _connect("period_start");
+    const uint32_t capture = _connect("period_capture");
+    const uint32_t stop = _connect("period_stop");
+    _disable((1 << start) | (1 << capture) | (1 << stop));
+}
+
+static void _configure_drift_timer(void) {
+    const uint32_t start = _connect("drift_start");
+    const uint32_t capture = _connect("drift_capture");
+    _disable((1 << start) | (1 << capture));
+}
+
+/* left disabled by _proximity_enable(false) until _STATE_AUTONOMOUS_LOW_FREQUENCY */
+static void _configure_proximity(void) {
+    const uint32_t window_count = _connect("proximity_window_count");
+    const uint32_t approach = _connect("proximity_approach");
+    (void)_group(1 << approach);
+    const uint32_t rearm = _connect("proximity_approach_rearm");
+    const uint32_t reached = _connect("proximity_approach_reached");
+    _disable((1 << window_count) | (1 << approach) | (1 << rearm) | (1 << reached));
+}
+
+/* cap_touch_detect_task_connect() and cap_touch_output_init(), called by the application after cap_touch_init() */
+static void _detect_task_connect(void) {
+    _disable(1 << _connect("detect"));
+}
+
+static void _output_init(void) {
+    (void)_connect("output_active");
+}
+
+static bool _check(void) {
+    bool ok = true;
+    for (size_t i = 0; i < _connections_num; i++) {
+        const struct _connection *c = &_connections[i];
+        if (NRF_PPI->CH[c->channel].EEP != (uint32_t)&_events[i] || NRF_PPI->CH[c->channel].TEP != (uint32_t)&_tasks[i]) {
+            fprintf(stderr, "  %s on channel %u was overwritten\n", c->name, c->channel);
+            ok = false;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (_connections[j].channel == c->channel) {
+                fprintf(stderr, "  %s and %s share channel %u\n", _connections[j].name, c->name, c->channel);
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+struct _scenario {
+    const char *name;
+    void (*const steps[8])(void);
+};
+
+static const struct _scenario _scenarios[] = {
+    // debug.conf: CONFIG_BT enables radio coexist, CONFIG_CLOCK_CONTROL_NRF_K32SRC_RC drift compensation
+    {"radio coexist, drift", {_configure_ppi, _configure_radio_coexist, _configure_drift_timer}},
+    {"period measure, drift", {_configure_ppi, _configure_period_timer, _configure_drift_timer}},
+    {"period measure, detect task, output pin", {_configure_ppi, _configure_period_timer, _detect_task_connect, _output_init}},
+    {"radio coexist, drift, detect task, output pin", {_configure_ppi, _configure_radio_coexist, _configure_drift_timer, _detect_task_connect, _output_init}},
+    {"drift, proximity, detect task, output pin", {_configure_ppi, _configure_drift_timer, _configure_proximity, _detect_task_connect, _output_init}},
+    {"radio coexist, drift, proximity", {_configure_ppi, _configure_radio_coexist, _configure_drift_timer, _configure_proximity}},
+};
+
+static bool _scenario_run(const struct _scenario *scenario) {
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return false;
+    }
+    if (pid == 0) {
+        for (size_t i = 0; i < ARRAY_SIZE(scenario->steps) && scenario->steps[i]; i++) {
+            scenario->steps[i]();
+        }
+        exit(_check() ? 0 : 1);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) < 0) return false;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(void) {
+    int failed = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(_scenarios); i++) {
+        const bool ok = _scenario_run(&_scenarios[i]);
+        printf("%-48s %s\n", _scenarios[i].name, ok ? "ok" : "FAILED");
+        failed += !ok;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,31 @@
+/* host model of the nRF52832 PPI registers used by ppi_connect.c. CHENSET and CHENCLR are applied by ppi_sync() in the test */
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t EN;
+    volatile uint32_t DIS;
+} NRF_PPI_TASKS_CHG_Type;
+
+typedef struct {
+    volatile uint32_t EEP;
+    volatile uint32_t TEP;
+} NRF_PPI_CH_Type;
+
+typedef struct {
+    volatile uint32_t TEP;
+} NRF_PPI_FORK_Type;
+
+typedef struct {
+    NRF_PPI_TASKS_CHG_Type TASKS_CHG[6];
+    volatile uint32_t CHEN;
+    volatile uint32_t CHENSET;
+    volatile uint32_t CHENCLR;
+    NRF_PPI_CH_Type CH[20];
+    volatile uint32_t CHG[6];
+    NRF_PPI_FORK_Type FORK[32];
+} NRF_PPI_Type;
+
+extern NRF_PPI_Type ppi_model;
+#define NRF_PPI (&ppi_model)
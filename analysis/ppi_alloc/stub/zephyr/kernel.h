@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define __ASSERT(test, fmt, ...) do { if (!(test)) { fprintf(stderr, "assert: " fmt "\n", ##__VA_ARGS__); exit(1); } } while (0)
+#define __ASSERT_NO_MSG(test) __ASSERT(test, "%s", #test)
@@ -0,0 +1,4 @@
+#pragma once
+
+#define LOG_MODULE_REGISTER(...)
+#define LOG_DBG(...)
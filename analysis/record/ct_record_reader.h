@@ -0,0 +1,124 @@
+/*
+ * File: ct_record_reader.h
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Memory mapped reader of the binary recording format, host only
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Usage:
+ * 
+ *     struct ct_record_reader reader;
+ *     struct ct_record_chunk chunk;
+ *     if (ct_record_open(&reader, path)) error;
+ *     while (ct_record_chunk_next(&reader, &chunk)) { chunk.count[0][i] ... }
+ *     ct_record_close(&reader);
+ * 
+ * Nothing is copied, the column pointers point into the mapping. See src/cap_touch/ct_record.h for the format.
+*/
+
+#pragma once
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cap_touch/ct_record.h"
+
+#define CT_RECORD_CHANNELS_MAX 8
+
+struct ct_record_reader {
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+    const struct ct_record_header *header;
+};
+
+struct ct_record_chunk {
+    const struct ct_record_chunk_header *header;
+    const uint32_t *timestamp_ms;
+    const uint16_t *count[CT_RECORD_CHANNELS_MAX];
+    const uint16_t *filtered[CT_RECORD_CHANNELS_MAX];
+    const uint8_t *transformed[CT_RECORD_CHANNELS_MAX];
+    const uint8_t *mode;
+};
+
+/* returns 0 on success, -1 if the file can not be mapped or is not a valid recording */
+static inline int ct_record_open(struct ct_record_reader *r, const char *path) {
+    *r = (struct ct_record_reader){0};
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(struct ct_record_header)) {
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+
+    r->data = data;
+    r->size = st.st_size;
+    r->header = (const struct ct_record_header *)data;
+    if (r->header->magic != CT_RECORD_MAGIC || r->header->version != CT_RECORD_VERSION || r->header->channels == 0 ||
+        r->header->channels > CT_RECORD_CHANNELS_MAX || r->header->header_size < sizeof(struct ct_record_header)) {
+        munmap(data, r->size);
+        *r = (struct ct_record_reader){0};
+        return -1;
+    }
+    r->offset = CT_RECORD_ALIGN4(r->header->header_size);
+    return 0;
+}
+
+/* returns false at the end of the file, or on a truncated or corrupt chunk */
+static inline bool ct_record_chunk_next(struct ct_record_reader *r, struct ct_record_chunk *c) {
+    if (r->offset + sizeof(struct ct_record_chunk_header) > r->size) return false;
+
+    const uint8_t *base = r->data + r->offset;
+    const struct ct_record_chunk_header *header = (const struct ct_record_chunk_header *)base;
+    const uint8_t channels = r->header->channels;
+    const size_t size = CT_RECORD_CHUNK_SIZE(header->rows, channels);
+    if (header->magic != CT_RECORD_CHUNK_MAGIC || header->rows > CT_RECORD_CHUNK_ROWS_MAX || r->offset + size > r->size) return false;
+
+    const uint16_t rows = header->rows;
+    c->header = header;
+    c->timestamp_ms = (const uint32_t *)(base + CT_RECORD_OFFSET_TIMESTAMP(rows, channels));
+    for (uint8_t ch = 0; ch < channels; ch++) {
+        c->count[ch] = (const uint16_t *)(base + CT_RECORD_OFFSET_COUNT(rows, channels, ch));
+        c->filtered[ch] = (const uint16_t *)(base + CT_RECORD_OFFSET_FILTERED(rows, channels, ch));
+        c->transformed[ch] = base + CT_RECORD_OFFSET_TRANSFORMED(rows, channels, ch);
+    }
+    c->mode = base + CT_RECORD_OFFSET_MODE(rows, channels);
+    r->offset += size;
+    return true;
+}
+
+static inline void ct_record_close(struct ct_record_reader *r) {
+    if (r->data) munmap((void *)r->data, r->size);
+    *r = (struct ct_record_reader){0};
+}
@@ -0,0 +1,177 @@
+/*
+ * File: log2ctr.c
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Streaming converter from the bt_log text recordings to the binary recording format
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Usage: log2ctr [--offset N] [--description text] <input.log> <output.ctr>
+ * 
+ * Each line of the input is the little endian uint16 columns of a bt_log notification: sample, filtered and transformed from ct_current_oscillate.c,
+ * or only the sample from ct_adc_charge_share.c. "Notifications started." starts a new segment. With --offset, the chunk label is the finger distance
+ * segment - N in mm, as in analysis/artificial_finger/analyze.ipynb. The logs have no timestamps, they are generated from the nominal sample period.
+ * 
+ * Only one chunk is held in memory, so input size is not limited.
+*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cap_touch/ct_record.h"
+
+/* same operation parameters as ct_current_oscillate.c */
+#define RTC_TICKS_SAMPLE 4
+#define RTC_TICKS_SAMPLE_HF 500
+#define RTC_TICKS_RESET 4000
+#define SAMPLE_PERIOD_US ((uint32_t)((uint64_t)RTC_TICKS_RESET * 1000000 / 32768))
+
+struct chunk {
+    uint16_t rows;
+    uint16_t segment;
+    int16_t label;
+    uint32_t timestamp_ms[CT_RECORD_CHUNK_ROWS_MAX];
+    uint16_t count[CT_RECORD_CHUNK_ROWS_MAX];
+    uint16_t filtered[CT_RECORD_CHUNK_ROWS_MAX];
+    uint8_t transformed[CT_RECORD_CHUNK_ROWS_MAX];
+};
+
+static int _chunk_write(FILE *out, struct chunk *c) {
+    if (c->rows == 0) return 0;
+
+    const struct ct_record_chunk_header header = {
+        .magic = CT_RECORD_CHUNK_MAGIC,
+        .rows = c->rows,
+        .segment = c->segment,
+        .label = c->label,
+    };
+    static const uint8_t zeros[4] = {0};
+    uint8_t mode[CT_RECORD_CHUNK_ROWS_MAX];
+    memset(mode, CT_RECORD_MODE_HIGH_FREQUENCY, c->rows); // the device only logs in _STATE_HIGH_FREQUENCY
+
+    size_t written = fwrite(&header, sizeof(header), 1, out);
+    written += fwrite(c->timestamp_ms, sizeof(uint32_t), c->rows, out) == c->rows;
+    written += fwrite(c->count, sizeof(uint16_t), c->rows, out) == c->rows;
+    written += fwrite(c->filtered, sizeof(uint16_t), c->rows, out) == c->rows;
+    written += fwrite(c->transformed, sizeof(uint8_t), c->rows, out) == c->rows;
+    written += fwrite(mode, sizeof(uint8_t), c->rows, out) == c->rows;
+    const size_t padding = CT_RECORD_CHUNK_SIZE(c->rows, 1) - sizeof(header) - c->rows * (4 + 2 + 2 + 1 + 1);
+    if (padding) written += fwrite(zeros, 1, padding, out) == padding;
+    else written++;
+    c->rows = 0;
+    return written == 7 ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    bool has_offset = false;
+    int offset = 0;
+    const char *description = "";
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-' && argv[arg][1] == '-'; arg += 2) {
+        if (arg + 1 >= argc) break;
+        if (!strcmp(argv[arg], "--offset")) {
+            has_offset = true;
+            offset = atoi(argv[arg + 1]);
+        } else if (!strcmp(argv[arg], "--description")) {
+            description = argv[arg + 1];
+        } else {
+            break;
+        }
+    }
+    if (argc - arg != 2) {
+        fprintf(stderr, "usage: %s [--offset N] [--description text] <input.log> <output.ctr>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[arg], "r");
+    if (in == NULL) {
+        perror(argv[arg]);
+        return 1;
+    }
+    FILE *out = fopen(argv[arg + 1], "wb");
+    if (out == NULL) {
+        perror(argv[arg + 1]);
+        fclose(in);
+        return 1;
+    }
+
+    struct ct_record_header header = {
+        .magic = CT_RECORD_MAGIC,
+        .version = CT_RECORD_VERSION,
+        .header_size = sizeof(struct ct_record_header),
+        .channels = 1,
+        .columns = CT_RECORD_COLUMN_TIMESTAMP | CT_RECORD_COLUMN_COUNT | CT_RECORD_COLUMN_MODE,
+        .flags = has_offset ? CT_RECORD_FLAG_LABEL_DISTANCE : 0,
+        .sample_period_us = SAMPLE_PERIOD_US,
+        .window_ticks_lf = RTC_TICKS_SAMPLE,
+        .window_ticks_hf = RTC_TICKS_SAMPLE_HF,
+    };
+    strncpy(header.description, description, CT_RECORD_DESCRIPTION_SIZE - 1);
+    fwrite(&header, sizeof(header), 1, out); // rewritten at the end with the columns found
+
+    static struct chunk chunk;
+    int segment = -1;
+    uint64_t row = 0, rows_total = 0;
+    bool three_columns = false, error = false;
+    char line[128];
+    while (!error && fgets(line, sizeof(line), in) != NULL) {
+        if (!strncmp(line, "Notifications started.", 22)) {
+            error |= _chunk_write(out, &chunk) != 0;
+            segment++;
+            row = 0;
+            continue;
+        }
+
+        unsigned int b[6];
+        const int n = line[2] == ' ' ? sscanf(line, "%2x %2x %2x %2x %2x %2x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) : 0;
+        if (n < 2) continue;
+
+        if (chunk.rows == CT_RECORD_CHUNK_ROWS_MAX) error |= _chunk_write(out, &chunk) != 0;
+        const uint16_t segment_idx = segment < 0 ? 0 : segment;
+        chunk.segment = segment_idx;
+        chunk.label = has_offset ? (int16_t)(segment_idx - offset) : 0;
+        chunk.timestamp_ms[chunk.rows] = (uint32_t)(row * SAMPLE_PERIOD_US / 1000);
+        chunk.count[chunk.rows] = b[0] | b[1] << 8;
+        chunk.filtered[chunk.rows] = n >= 4 ? (b[2] | b[3] << 8) : 0;
+        chunk.transformed[chunk.rows] = n >= 6 ? (b[4] | b[5] << 8) : 0;
+        three_columns |= n >= 6;
+        chunk.rows++;
+        row++;
+        rows_total++;
+    }
+    error |= _chunk_write(out, &chunk) != 0;
+
+    if (three_columns) header.columns |= CT_RECORD_COLUMN_FILTERED | CT_RECORD_COLUMN_TRANSFORMED;
+    error |= fseek(out, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, out) != 1;
+    error |= fclose(out) != 0;
+    fclose(in);
+    if (error) {
+        fprintf(stderr, "failed writing %s\n", argv[arg + 1]);
+        return 1;
+    }
+    printf("%s: %llu rows, %d segments\n", argv[arg + 1], (unsigned long long)rows_total, segment + 1 > 0 ? segment + 1 : 1);
+    return 0;
+}
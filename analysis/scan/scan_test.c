@@ -0,0 +1,150 @@
+/*
+ * File: scan_test.c
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Host test of the pad slot assignment in ct_scan.h
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Usage: scan_test
+ * 
+ * Runs ct_scan_next() and ct_scan_update() over scripted pad activity and checks the slot assignment: LF rotation with dwell over the idle
+ * pads, HF slots for active pads and their neighbours with one idle LF slot in idle_every, the wheel neighbours and the hold time before
+ * an active pad is idle again. Exits with 1 if any case fails.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cap_touch/ct_scan.h"
+
+static int _failed = 0;
+
+#define EXPECT(cond, ...) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "line %d: ", __LINE__); \
+        fprintf(stderr, __VA_ARGS__); \
+        fprintf(stderr, "\n"); \
+        _failed++; \
+    } \
+} while (0)
+
+/* counts the slots per pad and mode over count slots, the pads in touched report a level above 0 */
+static void _slots_run(struct ct_scan *s, size_t count, uint8_t touched, unsigned hf[CT_SCAN_PADS_MAX], unsigned lf[CT_SCAN_PADS_MAX]) {
+    for (size_t i = 0; i < CT_SCAN_PADS_MAX; i++) hf[i] = lf[i] = 0;
+    for (size_t i = 0; i < count; i++) {
+        const struct ct_scan_slot slot = ct_scan_next(s);
+        if (slot.pad >= s->pads) {
+            EXPECT(false, "slot %zu on pad %u of %u", i, slot.pad, s->pads);
+            continue;
+        }
+        if (slot.mode == CT_SCAN_MODE_HF) hf[slot.pad]++;
+        else lf[slot.pad]++;
+        ct_scan_update(s, slot.pad, touched & (1 << slot.pad) ? 50 : 0);
+    }
+}
+
+static void _test_idle_rotation(void) {
+    struct ct_scan s = CT_SCAN_INIT(4, false);
+    for (uint8_t i = 0; i < 2 * 4 * 4; i++) {
+        const struct ct_scan_slot slot = ct_scan_next(&s);
+        const uint8_t pad = (i / 4) % 4; // lf_dwell slots on each pad in turn
+        EXPECT(slot.mode == CT_SCAN_MODE_LF && slot.pad == pad, "idle slot %u: pad %u mode %u, expected LF on pad %u", i, slot.pad, slot.mode, pad);
+        ct_scan_update(&s, slot.pad, 0);
+    }
+}
+
+static void _test_active_slots(void) {
+    struct ct_scan s = CT_SCAN_INIT(6, false);
+    ct_scan_update(&s, 1, 50); // pad 0, 1 and 2 active
+
+    unsigned hf[CT_SCAN_PADS_MAX], lf[CT_SCAN_PADS_MAX];
+    _slots_run(&s, 4 * 6, 1 << 1, hf, lf);
+    for (uint8_t pad = 0; pad < 3; pad++) {
+        EXPECT(hf[pad] == 6 && lf[pad] == 0, "active pad %u: %u HF, %u LF slots", pad, hf[pad], lf[pad]);
+    }
+    EXPECT(lf[3] + lf[4] + lf[5] == 6 && hf[3] + hf[4] + hf[5] == 0, "idle pads: %u LF, %u HF slots", lf[3] + lf[4] + lf[5], hf[3] + hf[4] + hf[5]);
+
+    // a second touch on an idle pad is detected in its LF slot, and the pad and its neighbours get HF slots from then on
+    _slots_run(&s, 4 * 6, 1 << 1 | 1 << 4, hf, lf);
+    EXPECT(lf[4] > 0, "idle pad 4 had no LF slot");
+    _slots_run(&s, 4 * 6, 1 << 1 | 1 << 4, hf, lf);
+    for (uint8_t pad = 0; pad < 6; pad++) {
+        EXPECT(hf[pad] > 0 && lf[pad] == 0, "pad %u after second touch: %u HF, %u LF slots", pad, hf[pad], lf[pad]);
+    }
+}
+
+static void _test_all_active(void) {
+    struct ct_scan s = CT_SCAN_INIT(3, false);
+    ct_scan_update(&s, 1, 50);
+
+    unsigned hf[CT_SCAN_PADS_MAX], lf[CT_SCAN_PADS_MAX];
+    _slots_run(&s, 3 * 4, 1 << 1, hf, lf);
+    for (uint8_t pad = 0; pad < 3; pad++) {
+        EXPECT(hf[pad] == 4 && lf[pad] == 0, "pad %u with all active: %u HF, %u LF slots", pad, hf[pad], lf[pad]);
+    }
+}
+
+static void _test_wheel_neighbours(void) {
+    struct ct_scan s = CT_SCAN_INIT(5, true);
+    ct_scan_update(&s, 0, 50); // pad 4, 0 and 1 active
+
+    unsigned hf[CT_SCAN_PADS_MAX], lf[CT_SCAN_PADS_MAX];
+    _slots_run(&s, 8, 1 << 0, hf, lf);
+    EXPECT(hf[4] == 2 && hf[0] == 2 && hf[1] == 2, "wheel neighbours: %u %u %u HF slots", hf[4], hf[0], hf[1]);
+    EXPECT(hf[2] + hf[3] == 0 && lf[2] + lf[3] == 2, "wheel idle pads: %u HF, %u LF slots", hf[2] + hf[3], lf[2] + lf[3]);
+
+    struct ct_scan slider = CT_SCAN_INIT(5, false);
+    ct_scan_update(&slider, 0, 50); // no neighbour before pad 0
+    EXPECT(slider.activity[4] == 0 && slider.activity[1] > 0, "slider neighbours of pad 0");
+}
+
+static void _test_hold(void) {
+    struct ct_scan s = CT_SCAN_INIT(4, false);
+    ct_scan_update(&s, 0, 50); // pad 0 and 1 active
+
+    // released: each active pad takes hold HF slots at level 0 before it is idle
+    unsigned hf[CT_SCAN_PADS_MAX], lf[CT_SCAN_PADS_MAX];
+    const size_t hf_slots = 2 * s.hold;
+    _slots_run(&s, hf_slots + hf_slots / (s.idle_every - 1), 0, hf, lf);
+    EXPECT(hf[0] == s.hold && hf[1] == s.hold, "hold: %u and %u HF slots, expected %u", hf[0], hf[1], s.hold);
+    EXPECT(s.activity[0] == 0 && s.activity[1] == 0, "pads still active after hold");
+
+    for (uint8_t i = 0; i < 4 * 4; i++) {
+        const struct ct_scan_slot slot = ct_scan_next(&s);
+        EXPECT(slot.mode == CT_SCAN_MODE_LF, "slot %u after hold is HF on pad %u", i, slot.pad);
+        ct_scan_update(&s, slot.pad, 0);
+    }
+}
+
+int main(void) {
+    _test_idle_rotation();
+    _test_active_slots();
+    _test_all_active();
+    _test_wheel_neighbours();
+    _test_hold();
+    printf("%s\n", _failed ? "FAILED" : "ok");
+    return _failed ? 1 : 0;
+}
@@ -0,0 +1,350 @@
+/*
+ * File: touch_bench.c
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Host benchmark of the cap touch engine on scripted touch scenarios
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Runs scripted touch scenarios through a model of the ct_current_oscillate.c chain: the electrode model gives the count of each window, the PPI
+ * chain is modelled per RTC period (autonomous wake, calibration captures), and the sample processing uses the same filter and transform headers as the target.
+ * 
+ * Emits JSON metrics per scenario. All metrics are lower is better:
+ * - cpu_wakeups_per_sec: sample interrupts and calibration work
+ * - comp_active_permille: peripheral active time, as COMP on time relative to total time. The counting TIMER and the RTC run always, and
+ *   starting and stopping the TIMER makes no difference on power (see _configure_ppi), so the COMP windows are the only varying part
+ * - hf_residency_permille: time in _STATE_HIGH_FREQUENCY
+ * - latency_p50_ms, latency_p90_ms, latency_max_ms: from touch start until the first output above 0
+ * - missed_touches: touches without any output above 0
+ * - false_touches_per_hour: outputs rising above 0 without a touch, per hour of scenario time
+ * 
+ * With --baseline <file>, the metrics are compared to a previous run and the exit code is non zero on regression.
+*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cap_touch/ct_electrode_model.h"
+#include "cap_touch/ct_filter.h"
+#include "cap_touch/ct_transform.h"
+#include "utils/sorted_index_get.h"
+
+/* same operation parameters as ct_current_oscillate.c */
+#define RTC_TICKS_SAMPLE 4
+#define RTC_TICKS_SAMPLE_HF 500
+#define RTC_TICKS_RESET 4000
+#define RTC_TICKS_WAKEUP 1 // from the LF sample end until the state change clears the RTC on the work queue
+#define RTC_CC_SAMPLE_START_VALUE 1
+#define CALIBRATION_START_DELAY_TICKS (10 * 32768 / 1000)
+#define CALIBRATION_PERIOD_INIT_SEC 1
+#define CALIBRATION_PERIOD_MAX_SEC (2*60)
+#define CALIBRATION_VAL_RESET 2
+#define CALIBRATION_RANK 3
+
+#define IDLE_SEC 30 // before each scenario, to let calibration settle
+#define TOUCHES_MAX 64
+#define REGRESSION_TOLERANCE_PERCENT 10
+
+struct touch {
+    double start_sec;
+    double rise_sec;    // linear ramp up, 0 for a step
+    double hold_sec;
+    double fall_sec;
+    uint32_t capacitance_ff;
+};
+
+struct scenario {
+    const char *name;
+    double duration_sec;
+    struct touch touches[TOUCHES_MAX];
+    size_t touch_count;
+    double noise_start_sec;
+    double noise_end_sec;
+    uint32_t noise_permille; // peak noise relative to count, during the noise burst
+};
+
+struct metrics {
+    double cpu_wakeups_per_sec;
+    double comp_active_permille;
+    double hf_residency_permille;
+    double latency_p50_ms;
+    double latency_p90_ms;
+    double latency_max_ms;
+    double missed_touches;
+    double false_touches_per_hour;
+};
+
+#define METRICS_FIELDS(X) \
+    X(cpu_wakeups_per_sec) \
+    X(comp_active_permille) \
+    X(hf_residency_permille) \
+    X(latency_p50_ms) \
+    X(latency_p90_ms) \
+    X(latency_max_ms) \
+    X(missed_touches) \
+    X(false_touches_per_hour)
+
+static void _scenario_periodic(struct scenario *s, double first_sec, double interval_sec, size_t count, struct touch touch) {
+    for (size_t i = 0; i < count && s->touch_count < TOUCHES_MAX; i++) {
+        touch.start_sec = first_sec + i * interval_sec;
+        s->touches[s->touch_count++] = touch;
+    }
+}
+
+static size_t _scenarios_get(struct scenario *s) {
+    memset(s, 0, 4 * sizeof(*s));
+
+    s[0] = (struct scenario){.name = "tap", .duration_sec = IDLE_SEC + 42};
+    _scenario_periodic(&s[0], IDLE_SEC + 1, 2, 20, (struct touch){.hold_sec = 0.15, .capacitance_ff = 10000});
+
+    s[1] = (struct scenario){.name = "hold", .duration_sec = IDLE_SEC + 32};
+    _scenario_periodic(&s[1], IDLE_SEC + 1, 6, 5, (struct touch){.hold_sec = 3, .capacitance_ff = 12000});
+
+    s[2] = (struct scenario){.name = "slow_approach", .duration_sec = IDLE_SEC + 42};
+    _scenario_periodic(&s[2], IDLE_SEC + 1, 8, 5, (struct touch){.rise_sec = 2, .hold_sec = 1, .fall_sec = 1, .capacitance_ff = 12000});
+
+    s[3] = (struct scenario){.name = "noise_burst", .duration_sec = IDLE_SEC + 30, .noise_start_sec = IDLE_SEC + 5, .noise_end_sec = IDLE_SEC + 15, .noise_permille = 30};
+    return 4;
+}
+
+static uint32_t _touch_capacitance(const struct touch *t, double now) {
+    const double dt = now - t->start_sec;
+    if (dt < 0) return 0;
+    if (dt < t->rise_sec) return t->capacitance_ff * dt / t->rise_sec;
+    if (dt < t->rise_sec + t->hold_sec) return t->capacitance_ff;
+    if (dt < t->rise_sec + t->hold_sec + t->fall_sec) return t->capacitance_ff * (1 - (dt - t->rise_sec - t->hold_sec) / t->fall_sec);
+    return 0;
+}
+
+/* a touch is counted from when it reaches half its capacitance */
+static double _touch_detect_start(const struct touch *t) {
+    return t->start_sec + t->rise_sec / 2;
+}
+
+static double _touch_detect_end(const struct touch *t) {
+    return t->start_sec + t->rise_sec + t->hold_sec + t->fall_sec / 2;
+}
+
+static int _double_compare(const void *a, const void *b) {
+    const double da = *(const double*)a, db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+static double _percentile(const double *sorted, size_t size, unsigned percent) {
+    if (size == 0) return 0;
+    const size_t rank = (percent * size + 99) / 100; // nearest rank
+    return sorted[rank ? rank - 1 : 0];
+}
+
+static struct metrics _scenario_run(const struct scenario *s) {
+    struct ct_electrode_model model = CT_ELECTRODE_MODEL_DEFAULT;
+    struct ct_filter filter = {0};
+    struct ct_counter_region region = ct_counter_region_calc(0, CT_ACTIVATE_MARGIN_DEFAULT, CT_SATURATE_MARGIN_DEFAULT);
+    bool state_hf = false;
+    bool filter_seed = false;
+
+    uint16_t calibration_buf[5] = {0};
+    uint8_t calibration_buf_idx = 0;
+    uint32_t calibration_cc_lf = CALIBRATION_VAL_RESET;
+    uint32_t calibration_cc_hf = CALIBRATION_VAL_RESET;
+    uint32_t calibration_period = CALIBRATION_PERIOD_INIT_SEC;
+    uint64_t calibration_next = CALIBRATION_START_DELAY_TICKS + (uint64_t)calibration_period * 32768;
+
+    uint64_t wakeups = 0, comp_ticks = 0, hf_ticks = 0;
+    uint8_t output_prev = 0;
+    double latency[TOUCHES_MAX];
+    bool detected[TOUCHES_MAX] = {0};
+    size_t false_touches = 0;
+
+    const uint64_t end = (uint64_t)(s->duration_sec * 32768);
+    uint64_t period = RTC_TICKS_RESET;
+    for (uint64_t now = 0; now < end; now += period) {
+        const double now_sec = (double)now / 32768;
+
+        uint32_t touch_ff = 0;
+        for (size_t i = 0; i < s->touch_count; i++) {
+            touch_ff += _touch_capacitance(&s->touches[i], now_sec);
+        }
+
+        const uint32_t window = state_hf ? RTC_TICKS_SAMPLE_HF - RTC_CC_SAMPLE_START_VALUE : RTC_TICKS_SAMPLE;
+        period = RTC_TICKS_RESET;
+        model.noise_counts = 0;
+        if (now_sec >= s->noise_start_sec && now_sec < s->noise_end_sec) {
+            model.noise_counts = ct_electrode_model_count(&model, window, touch_ff) * s->noise_permille / 1000;
+        }
+        model.noise_counts = model.noise_counts ? model.noise_counts : 1;
+        const uint32_t count = ct_electrode_model_count(&model, window, touch_ff);
+        comp_ticks += window;
+
+        // calibration capture compares, keeps the highest count since last capture
+        if (state_hf) {
+            if (count >= calibration_cc_hf) calibration_cc_hf = count;
+        } else if (count >= calibration_cc_lf) {
+            calibration_cc_lf = count;
+        }
+
+        if (!state_hf) {
+            // autonomous mode, the sample interrupt is only enabled below the activate level
+            if (count < region.activate) {
+                wakeups++;
+                state_hf = true;
+                filter_seed = true; // the first HF sample restarts the filter chain
+                // the transition to _STATE_HIGH_FREQUENCY clears the RTC, the first HF window starts right after the wakeup sample
+                period = RTC_CC_SAMPLE_START_VALUE + RTC_TICKS_SAMPLE + RTC_TICKS_WAKEUP;
+            }
+        } else {
+            wakeups++;
+            if (filter_seed) {
+                filter_seed = false;
+                ct_filter_seed(&filter, count);
+            }
+            (void)ct_filter_process(&filter, count);
+            const int32_t transformed = ct_transform(filter.value, &region, RTC_TICKS_SAMPLE, RTC_TICKS_SAMPLE_HF, 0);
+            const uint8_t output = transformed < 0 ? output_prev : (uint8_t)transformed;
+            if (output == 0) state_hf = false; // the RTC is cleared here as well, but the LF period is as long as the HF period
+
+            if (output > 0 && output_prev == 0) {
+                bool touched = false;
+                const double output_sec = now_sec + (double)window / 32768;
+                for (size_t i = 0; i < s->touch_count; i++) {
+                    const struct touch *t = &s->touches[i];
+                    // rising output within a touch, or shortly around it
+                    if (output_sec + 0.5 < _touch_detect_start(t) || output_sec > _touch_detect_end(t) + 1) continue;
+                    touched = true;
+                    if (!detected[i]) {
+                        detected[i] = true;
+                        latency[i] = output_sec > _touch_detect_start(t) ? (output_sec - _touch_detect_start(t)) * 1000 : 0;
+                    }
+                }
+                false_touches += !touched;
+            }
+            output_prev = output;
+            hf_ticks += period;
+        }
+
+        if (now >= calibration_next) {
+            wakeups++;
+            const uint32_t hf_norm = calibration_cc_hf * RTC_TICKS_SAMPLE / RTC_TICKS_SAMPLE_HF;
+            const uint32_t consolidate = calibration_cc_lf == CALIBRATION_VAL_RESET ? (calibration_cc_lf > hf_norm ? calibration_cc_lf : hf_norm) : calibration_cc_lf;
+            calibration_cc_lf = CALIBRATION_VAL_RESET;
+            calibration_cc_hf = CALIBRATION_VAL_RESET;
+            if (consolidate > CALIBRATION_VAL_RESET) {
+                calibration_buf[calibration_buf_idx] = consolidate;
+                calibration_buf_idx = (calibration_buf_idx + 1) % 5;
+                const uint16_t calibration = sorted_index_get(calibration_buf, 5, CALIBRATION_RANK);
+                if (calibration != region.nominal || region.activate < 2) {
+                    region = ct_counter_region_calc(calibration, CT_ACTIVATE_MARGIN_DEFAULT, CT_SATURATE_MARGIN_DEFAULT);
+                }
+                calibration_period = calibration_period << 1 > CALIBRATION_PERIOD_MAX_SEC ? CALIBRATION_PERIOD_MAX_SEC : calibration_period << 1;
+            }
+            calibration_next = now + (uint64_t)calibration_period * 32768;
+        }
+    }
+
+    // includes the initial idle time
+    struct metrics m = {0};
+    const double duration = s->duration_sec;
+    m.cpu_wakeups_per_sec = wakeups / duration;
+    m.comp_active_permille = 1000.0 * comp_ticks / end;
+    m.hf_residency_permille = 1000.0 * hf_ticks / end;
+
+    double sorted[TOUCHES_MAX];
+    size_t n = 0;
+    for (size_t i = 0; i < s->touch_count; i++) {
+        if (detected[i]) sorted[n++] = latency[i];
+    }
+    qsort(sorted, n, sizeof(double), _double_compare);
+    m.latency_p50_ms = _percentile(sorted, n, 50);
+    m.latency_p90_ms = _percentile(sorted, n, 90);
+    m.latency_max_ms = n ? sorted[n - 1] : 0;
+    m.missed_touches = s->touch_count - n;
+    m.false_touches_per_hour = false_touches * 3600 / duration;
+    return m;
+}
+
+static void _metrics_print(FILE *f, const struct scenario *s, const struct metrics *m, size_t count) {
+    fprintf(f, "{\n");
+    for (size_t i = 0; i < count; i++) {
+        fprintf(f, "  \"%s\": {\n", s[i].name);
+#define X(field) fprintf(f, "    \"" #field "\": %.3f%s\n", m[i].field, strcmp(#field, "false_touches_per_hour") ? "," : "");
+        METRICS_FIELDS(X)
+#undef X
+        fprintf(f, "  }%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(f, "}\n");
+}
+
+/* baseline is the output format of _metrics_print, one metric per line */
+static int _baseline_compare(const char *path, const struct scenario *s, const struct metrics *m, size_t count) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    int regressions = 0;
+    char line[256], scenario[64] = "", key[64];
+    double baseline;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, " \"%63[^\"]\": {", key) == 1 && strchr(line, '{') != NULL) {
+            strcpy(scenario, key);
+            continue;
+        }
+        if (sscanf(line, " \"%63[^\"]\": %lf", key, &baseline) != 2) continue;
+
+        for (size_t i = 0; i < count; i++) {
+            if (strcmp(s[i].name, scenario)) continue;
+            double value = -1;
+#define X(field) if (!strcmp(key, #field)) value = m[i].field;
+            METRICS_FIELDS(X)
+#undef X
+            if (value < 0) continue;
+            // small absolute margin, such that zero baselines do not fail on rounding
+            const double limit = baseline * (100 + REGRESSION_TOLERANCE_PERCENT) / 100 + 0.01;
+            if (value > limit) {
+                fprintf(stderr, "regression %s.%s: %.3f, baseline %.3f\n", scenario, key, value, baseline);
+                regressions++;
+            }
+        }
+    }
+    fclose(f);
+    return regressions ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    static struct scenario scenarios[4];
+    struct metrics metrics[4];
+    const size_t count = _scenarios_get(scenarios);
+
+    for (size_t i = 0; i < count; i++) {
+        metrics[i] = _scenario_run(&scenarios[i]);
+    }
+    _metrics_print(stdout, scenarios, metrics, count);
+
+    if (argc == 3 && !strcmp(argv[1], "--baseline")) {
+        return _baseline_compare(argv[2], scenarios, metrics, count);
+    }
+    return 0;
+}
@@ -27,16 +27,34 @@
 #include "bt_log.h"
 
 #include <errno.h>
+#include <string.h>
 
 #include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/gatt.h>
 
 #include "bluetooth/bt_connection_manager.h"
+#if CONFIG_CAP_TOUCH_LIVE_TUNING
+#include "cap_touch/cap_touch.h"
+#endif
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(bt_log, 3);
 
 static void _ccc_cfg_changed_bt(const struct bt_gatt_attr* attr, uint16_t value);
+#if CONFIG_CAP_TOUCH_LIVE_TUNING
+static ssize_t _tuning_read(struct bt_conn* conn, const struct bt_gatt_attr* attr, void* buf, uint16_t len, uint16_t offset);
+static ssize_t _tuning_write(struct bt_conn* conn, const struct bt_gatt_attr* attr, const void* buf, uint16_t len, uint16_t offset, uint8_t flags);
+/* the whole struct cap_touch_tuning, applied at the next sample window boundary */
+#define _TUNING_ATTRIBUTES , \
+    BT_GATT_CHARACTERISTIC( \
+        BT_UUID_BLE_LOG_TUNING_CHARACTERISTIC, \
+        BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE, \
+        BT_GATT_PERM_READ | BT_GATT_PERM_WRITE, \
+        _tuning_read, _tuning_write, NULL \
+    )
+#else
+#define _TUNING_ATTRIBUTES
+#endif
 
 
 
@@ -50,6 +68,7 @@ BT_GATT_SERVICE_DEFINE(_bt_log_service,
         NULL, NULL, NULL
     ), // No read or write callback functions
     BT_GATT_CCC(_ccc_cfg_changed_bt, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE)
+    _TUNING_ATTRIBUTES
 );
 
 int bt_log_notify(uint8_t* buf, size_t size) {
@@ -73,4 +92,32 @@ int bt_log_notify(uint8_t* buf, size_t size) {
 
 static void _ccc_cfg_changed_bt(const struct bt_gatt_attr* attr, uint16_t value) {
   LOG_INF("BT LOG Notification %s", value ? "enabled" : "disabled");
-}
\ No newline at end of file
+}
+
+#if CONFIG_CAP_TOUCH_LIVE_TUNING
+static ssize_t _tuning_read(struct bt_conn* conn, const struct bt_gatt_attr* attr, void* buf, uint16_t len, uint16_t offset) {
+  struct cap_touch_tuning tuning;
+  cap_touch_tuning_get(&tuning);
+  return bt_gatt_attr_read(conn, attr, buf, len, offset, &tuning, sizeof(tuning));
+}
+
+static ssize_t _tuning_write(struct bt_conn* conn, const struct bt_gatt_attr* attr, const void* buf, uint16_t len, uint16_t offset, uint8_t flags) {
+  if (offset != 0) {
+    return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+  }
+  if (len != sizeof(struct cap_touch_tuning)) {
+    return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+  }
+
+  struct cap_touch_tuning tuning;
+  memcpy(&tuning, buf, sizeof(tuning));
+  int err = cap_touch_tuning_set(&tuning);
+  if (err == -EBUSY) {
+    return BT_GATT_ERR(BT_LOG_ATT_ERR_TUNING_BUSY);
+  } else if (err) {
+    LOG_WRN("invalid tuning: %d", err);
+    return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+  }
+  return len;
+}
+#endif
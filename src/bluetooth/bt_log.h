@@ -40,4 +40,12 @@
 #define BT_UUID_BLE_LOG_CHARACTERISTIC \
     BT_UUID_DECLARE_128(BT_UUID_BLE_LOG_IO_VAL)
 
+// struct cap_touch_tuning, with CONFIG_CAP_TOUCH_LIVE_TUNING
+#define BT_UUID_BLE_LOG_TUNING_VAL \
+    BT_UUID_128_ENCODE(0x03b80e5a, 0xffff, 0xfffe, 0xa751, 0x6ce34ec4c700)
+#define BT_UUID_BLE_LOG_TUNING_CHARACTERISTIC \
+    BT_UUID_DECLARE_128(BT_UUID_BLE_LOG_TUNING_VAL)
+// application ATT error of a tuning write while the previous write is not applied yet, retry after the next sample window
+#define BT_LOG_ATT_ERR_TUNING_BUSY 0x80
+
 int bt_log_notify(uint8_t* buf, size_t size);
\ No newline at end of file
@@ -28,8 +28,96 @@
 
 #include <stdint.h>
 
+#if CONFIG_CAP_TOUCH_ZBUS
+#include <zephyr/zbus/zbus.h>
+
+enum cap_touch_msg_type {
+    CAP_TOUCH_MSG_DOWN,
+    CAP_TOUCH_MSG_UP,
+    CAP_TOUCH_MSG_HOLD,
+    CAP_TOUCH_MSG_APPROACH,
+    CAP_TOUCH_MSG_STUCK,    // followed by CAP_TOUCH_MSG_UP
+    CAP_TOUCH_MSG_LEVEL,
+};
+
+enum cap_touch_msg_mode {
+    CAP_TOUCH_MSG_MODE_LF,
+    CAP_TOUCH_MSG_MODE_HF,
+};
+
+struct cap_touch_msg {
+    uint32_t timestamp_ms;  // uptime
+    uint8_t type;           // enum cap_touch_msg_type
+    uint8_t level;          // 0 to 127
+    uint8_t mode;           // enum cap_touch_msg_mode
+    uint8_t channels;       // bitmap of touched electrodes
+};
+
+/* CAP_TOUCH_MSG_DOWN, _UP, _HOLD, _APPROACH and _STUCK */
+ZBUS_CHAN_DECLARE(cap_touch_chan_event);
+/* CAP_TOUCH_MSG_LEVEL, on every level change */
+ZBUS_CHAN_DECLARE(cap_touch_chan_level);
+#endif
+
+#if CONFIG_CAP_TOUCH_LIVE_TUNING
+/* runtime parameters of CONFIG_CAP_TOUCH_COMP_CURRENT, also the little endian format of the bt_log tuning characteristic */
+struct cap_touch_tuning {
+    uint8_t activate_margin;    // 1/256 of the calibration point
+    uint8_t saturate_margin;    // 1/256 of the calibration point
+    uint8_t iir_factor;         // 1/256 of the previous value
+    uint8_t comp_isource;       // COMP_ISOURCE_ISOURCE_*
+    uint8_t comp_speed;         // COMP_MODE_SP_*
+    uint8_t comp_th_up;         // 0 to 63
+    uint8_t comp_th_down;
+    uint8_t reserved;
+    uint16_t ticks_sample_lf;   // RTC ticks of a LF sample window
+    uint16_t ticks_sample_hf;   // at most 21845 (5461 with CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE), such that the count fits 16 bit
+    uint16_t ticks_reset_lf;    // RTC ticks of a LF sample period
+    uint16_t ticks_reset_hf;
+};
+_Static_assert(sizeof(struct cap_touch_tuning) == 16, "cap_touch_tuning layout");
+#endif
+
 typedef void (*cap_touch_event_t)(uint8_t value);
+typedef void (*cap_touch_approach_event_t)(void);
 
 void cap_touch_init(cap_touch_event_t event, uint32_t psel_comp, uint32_t psel_pin);
 
-void cap_touch_start(void);
\ No newline at end of file
+void cap_touch_start(void);
+
+/* stop sampling until the next cap_touch_start() */
+void cap_touch_stop(void);
+
+/* stop sampling from any running state, keeping calibration and filter state. Reports level 0 if touched. Only implemented by CONFIG_CAP_TOUCH_COMP_CURRENT */
+void cap_touch_suspend(void);
+
+/* continue after cap_touch_suspend() in the autonomous mode, with the kept thresholds from the first window. Starts if stopped.
+ * Only implemented by CONFIG_CAP_TOUCH_COMP_CURRENT */
+void cap_touch_resume(void);
+
+/* number of times the measurement chain was found stalled and restarted since boot */
+uint32_t cap_touch_incidents_get(void);
+
+/* trigger a peripheral task through PPI when a touch wakes the autonomous mode. Only implemented by CONFIG_CAP_TOUCH_COMP_CURRENT */
+void cap_touch_detect_task_connect(volatile uint32_t *task);
+
+/* hardware driven touch output, only from the stopped state. Only implemented by CONFIG_CAP_TOUCH_COMP_CURRENT, with CONFIG_CAP_TOUCH_OUTPUT_PIN */
+void cap_touch_output_init(uint32_t pin, int polarity);
+
+/* event when an approaching hand is detected before touch, only from the stopped state. Only implemented by CONFIG_CAP_TOUCH_COMP_CURRENT, with CONFIG_CAP_TOUCH_PROXIMITY */
+void cap_touch_approach_init(cap_touch_approach_event_t event_cb);
+
+/* measure relative to a reference electrode on a second COMP input, only from the stopped state. Only implemented by CONFIG_CAP_TOUCH_COMP_CURRENT, with CONFIG_CAP_TOUCH_DIFFERENTIAL */
+void cap_touch_reference_init(uint32_t psel_reference);
+
+/* start selecting the COMP setting of the electrode, only from the stopped state. Returns at once, the sampling starts when done if cap_touch_start() was called.
+ * Only implemented by CONFIG_CAP_TOUCH_COMP_CURRENT, with CONFIG_CAP_TOUCH_AUTOTUNE */
+int cap_touch_autotune(void);
+
+#if CONFIG_CAP_TOUCH_LIVE_TUNING
+/* current runtime parameters, including the COMP setting selected by autotune. Only implemented by CONFIG_CAP_TOUCH_COMP_CURRENT, with CONFIG_CAP_TOUCH_LIVE_TUNING */
+void cap_touch_tuning_get(struct cap_touch_tuning *tuning);
+
+/* applied at the end of the next sample window, -EBUSY while the previous update is pending. Only implemented by CONFIG_CAP_TOUCH_COMP_CURRENT, with CONFIG_CAP_TOUCH_LIVE_TUNING */
+int cap_touch_tuning_set(const struct cap_touch_tuning *tuning);
+#endif
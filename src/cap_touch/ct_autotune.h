@@ -0,0 +1,70 @@
+/*
+ * File: ct_autotune.h
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Noise statistics and scoring of COMP settings for the startup auto-tuning
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** A touch changes the count by a fixed fraction of the count, so the signal is proportional to the mean count of an untouched electrode.
+ * The SNR of a COMP setting is therefore estimated as mean / standard deviation, with the quantisation noise of 1/12 count^2 added to the variance,
+ * such that a noise free but coarse setting is not preferred. The score is SNR per current, squared to avoid a square root:
+ * 
+ *     score = mean^2 / ((variance + 1/12) * current^2)
+ * 
+ * Only the ordering of scores is meaningful. The header only depends on the C standard library, such that it can run on host.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+struct ct_autotune_stats {
+    uint32_t n;
+    uint64_t sum;
+    uint64_t sum_sq;
+};
+
+static inline void ct_autotune_stats_add(struct ct_autotune_stats *s, uint16_t sample) {
+    s->n++;
+    s->sum += sample;
+    s->sum_sq += (uint64_t)sample * sample;
+}
+
+static inline uint32_t ct_autotune_stats_mean(const struct ct_autotune_stats *s) {
+    return s->n ? (uint32_t)(s->sum / s->n) : 0;
+}
+
+/* 12 * variance + 1, i.e. variance including quantisation noise in units of 1/12 count^2 */
+static inline uint64_t ct_autotune_stats_variance12(const struct ct_autotune_stats *s) {
+    if (s->n < 2) return 1;
+    const uint64_t n = s->n;
+    return 12 * (n * s->sum_sq - s->sum * s->sum) / (n * n) + 1;
+}
+
+/* SNR per current squared, in arbitrary fixed point units. current_na is the average current of the setting while sampling */
+static inline uint64_t ct_autotune_score(const struct ct_autotune_stats *s, uint32_t current_na) {
+    const uint64_t mean = ct_autotune_stats_mean(s);
+    if (current_na == 0) return 0;
+    return ((mean * mean * 12) << 24) / ct_autotune_stats_variance12(s) / current_na / current_na;
+}
@@ -35,12 +35,94 @@
  * i.e. when there is no added capacitance from external factors. The calibration is done periodically, and filtered using a median filter. Furthermore, the system generates a calibration point from both _STATE_AUTONOMOUS_LOW_FREQUENCY
  * and _STATE_HIGH_FREQUENCY, becasue the two modes have different resolution and yields different period counts. Calibration in both modes is necessary to prevent deadlock (mallformed calibration point resulting in the system at 
  * idle being in _STATE_HIGH_FREQUENCY).
+ * 
+ * With CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE, _STATE_HIGH_FREQUENCY additionally times the first N oscillations of each window using a 16MHz timer. The sample is then
+ * the period time converted back to an equivalent count with _SAMPLE_FRAC_BITS extra bits of resolution, such that the rest of the processing is unchanged.
+ * HFXO is requested for the whole _STATE_HIGH_FREQUENCY period, as HFINT is only accurate to about 1.5%. Until it runs, the count is used.
+ * 
+ * With CONFIG_CAP_TOUCH_HF_ADAPTIVE_WINDOW, the length of each _STATE_HIGH_FREQUENCY window is selected from an online estimate of the sample noise and the
+ * distance of the filtered value from the activate level, see _sample_window_calc(). The sample interrupt programs the next window, and normalises the
+ * count to the full window, such that the rest of the processing is unchanged. HF calibration is only captured in full windows, so one full window is
+ * forced after each calibration capture. Otherwise a held clear touch only gets short windows, and the capture sees a stalled chain.
+ * 
+ * With CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE, the real length of a sample window is periodically measured against HFCLK. Counts are normalised to the nominal
+ * window length, and the autonomous trigger level is scaled to the real window length, such that LFRC drift does not show up as capacitance.
+ * 
+ * With CONFIG_CAP_TOUCH_DIFFERENTIAL, COMP PSEL is switched to a reference electrode for some windows: in _STATE_HIGH_FREQUENCY from the sample
+ * interrupt, and in _STATE_AUTONOMOUS_LOW_FREQUENCY from a sample end interrupt every CONFIG_CAP_TOUCH_DIFFERENTIAL_LF_PERIOD_MS. The reference window
+ * triggers the EGU event regardless of its count, without touch output, calibration or integration. Counts are scaled by the reference change since
+ * start, in the same way as the drift compensation, such that common-mode changes of the oscillator cancel. PSEL can not be changed through PPI, so
+ * the autonomous mode is not differential at every window.
+ * 
+ * With CONFIG_CAP_TOUCH_DRIVER, the TIMER, RTC and EGU are selected by the devicetree node of ct_driver.c, which also calls the API of this module.
+ * 
+ * With CONFIG_CAP_TOUCH_RADIO_COEXIST, radio ramp up and disable events during a sample window are latched in an EGU event through PPI. Samples from windows with
+ * radio activity are discarded, in both states.
+ * 
+ * The _STATE_HIGH_FREQUENCY sample period is pseudo-randomly jittered by CONFIG_CAP_TOUCH_SAMPLE_JITTER_TICKS, such that periodic interference is spread
+ * into broadband noise instead of aliasing into the counts, where the low pass filter removes it.
+ * 
+ * With CONFIG_CAP_TOUCH_AUTOTUNE, the COMP current source, thresholds and speed mode are selected by measuring HF samples for each setting in _STATE_AUTOTUNE,
+ * see cap_touch_autotune() and ct_autotune.h. The selected setting is stored with the settings subsystem, such that it only runs at first boot.
+ * The samples are taken by _sample_process() on the work queue, one candidate after the other, such that cap_touch_start() returns at once and
+ * _STATE_AUTONOMOUS_LOW_FREQUENCY is entered when the last candidate is measured.
+ * 
+ * With CONFIG_CAP_TOUCH_OUTPUT_PIN, the EGU event which wakes the CPU on touch also sets a GPIOTE output, and the active trigger compare clears it in
+ * _STATE_AUTONOMOUS_LOW_FREQUENCY. The pin is thereby driven from the PPI chain alone. In _STATE_HIGH_FREQUENCY it stays set until the return to
+ * _STATE_AUTONOMOUS_LOW_FREQUENCY, and samples discarded because of radio activity still set it.
+ * 
+ * Other peripheral tasks can be triggered by the touch wakeup of _STATE_AUTONOMOUS_LOW_FREQUENCY with cap_touch_detect_task_connect(), such as the LED blink.
+ * 
+ * With CONFIG_CAP_TOUCH_PROXIMITY, _STATE_AUTONOMOUS_LOW_FREQUENCY also accumulates the oscillations of PROXIMITY_WINDOWS windows in a second counter, using the
+ * same inverted logic as the touch wakeup: an approach PPI group is enabled at the start of each integration and disabled when the accumulated count reaches
+ * the approach level. If it is still enabled when the window counter reaches PROXIMITY_WINDOWS, the approach EGU event is triggered. The resolution is
+ * PROXIMITY_WINDOWS times that of a single window, at the same COMP on time.
+ * 
+ * If _STATE_HIGH_FREQUENCY lasts CONFIG_CAP_TOUCH_STUCK_TIMEOUT_SEC, the touch is classified as stuck (object on the pad, water, baseline shift). The current
+ * filtered value becomes the calibration point, the output is released and _STATE_AUTONOMOUS_LOW_FREQUENCY is resumed, such that a covered device stays at idle current.
+ * 
+ * The measurement chain is checked at every calibration capture, which is a point where both an RTC period and a counted window are known to have
+ * passed: a missing RTC reset compare or no counted oscillations means the chain has stalled. It is then rebuilt through _STATE_OFF, see _chain_recover().
+ * 
+ * With CONFIG_CAP_TOUCH_ZBUS, the output is also published as typed messages on the zbus channels of cap_touch.h, see _msg_publish().
+ * 
+ * With CONFIG_CAP_TOUCH_RECORDER, every processed sample and every return to _STATE_AUTONOMOUS_LOW_FREQUENCY is pushed to the recorder of ct_recorder.h.
+ * A wakeup where no HF sample reaches level 1 (false wake), a stuck touch and a stalled chain trigger a record to flash.
+ * 
+ * The margins, IIR factor and RTC window lengths are read through _tuning. With CONFIG_CAP_TOUCH_LIVE_TUNING, cap_touch_tuning_set() writes the
+ * inactive one of two buffers, and the system work queue swaps them between two sample windows with the RTC stopped, see _tuning_swap_at_boundary().
+ * The sample path runs on the same work queue, such that it never sees a partly written or partly applied update, without taking a lock.
 */
 
 #include "cap_touch.h"
+#if CONFIG_CAP_TOUCH_TUNING_GENERATED
+#include "ct_tuning.h"
+#endif
+#if CONFIG_CAP_TOUCH_LIVE_TUNING
+#define CT_FILTER_IIR_FACTOR_RUNTIME
+#endif
+#include "ct_filter.h"
+#include "ct_transform.h"
+#if CONFIG_CAP_TOUCH_AUTOTUNE
+#include "ct_autotune.h"
+#endif
+#if CONFIG_CAP_TOUCH_RECORDER
+#include "ct_recorder.h"
+#include "ct_record.h"
+#endif
 
 #include <zephyr/kernel.h>
+#if CONFIG_CAP_TOUCH_DRIVER
+#include <zephyr/devicetree.h>
+#endif
 #include "nrf.h"
+#if CONFIG_CAP_TOUCH_AUTOTUNE_PERSIST || CONFIG_CAP_TOUCH_LIVE_TUNING_PERSIST
+#include <zephyr/settings/settings.h>
+#endif
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE || CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+#include <zephyr/drivers/clock_control.h>
+#include <zephyr/drivers/clock_control/nrf_clock_control.h>
+#endif
 
 #include "utils/ppi_connect.h"
 #include "utils/macros_common.h"
@@ -53,29 +135,33 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(cap_touch, LOG_LEVEL_DBG);
 
-struct _counter_region {
-    uint32_t nominal;
-    uint32_t activate;
-    uint32_t saturate;
-};
-
 enum _state {
     _STATE_UNINITIALIZED = 0,
     _STATE_NOT_SUPPORTED,
     _STATE_OFF,
     _STATE_AUTONOMOUS_LOW_FREQUENCY,
     _STATE_HIGH_FREQUENCY,
+    _STATE_AUTOTUNE,
+    _STATE_SUSPENDED,   // peripherals stopped like _STATE_OFF, with calibration, thresholds and filter state kept
 };
 #define _STATE_TRANSITION(from, to) ((from) << 8 | (to))
 
-#define _FIXED8_PERCENT(percent) ((percent) * (255) / 100)
-
 /* Resource selection */
+#if CONFIG_CAP_TOUCH_DRIVER
+// from the devicetree node instantiated by ct_driver.c
+#define DT_DRV_COMPAT bentdal_cap_touch_comp
+#define COUNTER_SELECT ((NRF_TIMER_Type *)DT_REG_ADDR(DT_INST_PHANDLE(0, counter)))
+#define RTC_SELECT ((NRF_RTC_Type *)DT_REG_ADDR(DT_INST_PHANDLE(0, rtc)))
+#define RTC_IRQn DT_IRQN(DT_INST_PHANDLE(0, rtc))
+#define EGU_SELECT ((NRF_EGU_Type *)DT_REG_ADDR(DT_INST_PHANDLE(0, egu)))
+#define EGU_IRQn DT_IRQN(DT_INST_PHANDLE(0, egu))
+#else
 #define COUNTER_SELECT NRF_TIMER2
 #define RTC_SELECT NRF_RTC2
 #define RTC_IRQn RTC2_IRQn
 #define EGU_SELECT NRF_EGU2
 #define EGU_IRQn SWI2_EGU2_IRQn
+#endif
 
 #define RTC_CC_SAMPLE_START_IDX 0
 #define RTC_CC_SAMPLE_END_IDX 1
@@ -84,36 +170,221 @@ enum _state {
 #define RTC_CC_SAMPLE_START_VALUE 1
 
 #define EGU_ACTIVATE_IDX 0
+#define EGU_RADIO_ACTIVE_IDX 1 // no interrupt, only used as a flag
+#define EGU_APPROACH_IDX 2
 
 #define COUNTER_CC_ACTIVE_TRIGGER 0
 #define COUNTER_CC_SAMPLE_CAPTURE 1
 #define COUNTER_CC_CALIBRATION_CAPTURE_LF 2
 #define COUNTER_CC_CALIBRATION_CAPTURE_HF 3
+#define COUNTER_CC_PERIOD_END COUNTER_CC_ACTIVE_TRIGGER // only 4 CC available. Active trigger is not used in _STATE_HIGH_FREQUENCY
+
+#if CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+#define PERIOD_TIMER_SELECT NRF_TIMER3
+#define PERIOD_TIMER_CC_CAPTURE 0
+#define PERIOD_OSCILLATIONS CONFIG_CAP_TOUCH_HF_PERIOD_OSCILLATIONS
+#define _SAMPLE_FRAC_BITS 2
+#else
+#define _SAMPLE_FRAC_BITS 0
+#endif
+
+#if CONFIG_CAP_TOUCH_PROXIMITY
+#define PROXIMITY_COUNTER_SELECT NRF_TIMER1 // oscillations, accumulated over the integration
+#define PROXIMITY_WINDOW_SELECT NRF_TIMER3 // sample windows of the integration
+#define PROXIMITY_COUNTER_CC_APPROACH 0
+#define PROXIMITY_WINDOW_CC_END 0
+#define PROXIMITY_WINDOWS CONFIG_CAP_TOUCH_PROXIMITY_WINDOWS
+#endif
 
-/* operation parameters of _STATE_AUTONOMOUS_LOW_FREQUENCY and _STATE_HIGH_FREQUENCY state */
+#if CONFIG_CAP_TOUCH_OUTPUT_PIN
+#define GPIOTE_OUTPUT_IDX CONFIG_CAP_TOUCH_OUTPUT_GPIOTE_CHANNEL
+#endif
+
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+#define DRIFT_TIMER_SELECT NRF_TIMER4
+#define DRIFT_TIMER_CC_CAPTURE 0
+#endif
+
+/* default operation parameters of _STATE_AUTONOMOUS_LOW_FREQUENCY and _STATE_HIGH_FREQUENCY state, see _tuning */
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+#define RTC_TICKS_SAMPLE CONFIG_CAP_TOUCH_DIFFERENTIAL_TICKS_SAMPLE_LF
+#else
 #define RTC_TICKS_SAMPLE 4
+#endif
 #define RTC_TICKS_SAMPLE_HF 500
 #define RTC_TICKS_RESET_LOW_FREQUENCY 4000
 #define RTC_TICKS_RESET_HIGH_FREQUENCY 4000
+#define RTC_TICKS_RESET_JITTER CONFIG_CAP_TOUCH_SAMPLE_JITTER_TICKS
+BUILD_ASSERT(RTC_TICKS_RESET_HIGH_FREQUENCY - RTC_TICKS_RESET_JITTER / 2 > RTC_TICKS_SAMPLE_HF + RTC_CC_SAMPLE_START_VALUE, "jitter overlaps sample window");
+#define RTC_TICKS_RESET_AUTOTUNE(ticks_sample_hf) ((ticks_sample_hf) + 32) // back to back HF windows, only leaving time for the interrupt
+/* samples are 16 bit. The fastest COMP oscillation is about 2.5 counts per RTC tick, so longer windows wrap the count */
+#define SAMPLE_COUNTS_PER_TICK_MAX 3
+#define SAMPLE_WINDOW_VALID(ticks_sample) ((uint32_t)(ticks_sample) * SAMPLE_COUNTS_PER_TICK_MAX <= (UINT16_MAX >> _SAMPLE_FRAC_BITS))
+BUILD_ASSERT(SAMPLE_WINDOW_VALID(RTC_TICKS_SAMPLE_HF), "sample count overflows");
+
+/* default COMP setting, used unless tuned */
+#define COMP_TH_MAX 63
+#define COMP_TH_OFFSET_LOW 5
+#define COMP_TH_OFFSET_HIGH 30
+BUILD_ASSERT(COMP_TH_OFFSET_HIGH <= COMP_TH_MAX && COMP_TH_OFFSET_LOW <= COMP_TH_MAX && COMP_TH_OFFSET_HIGH > COMP_TH_OFFSET_LOW, "COMP offsets invalid");
+
+#if CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+/* length of the HF sample window in 16MHz ticks, used to convert period time to count. The window runs from RTC_CC_SAMPLE_START_VALUE to ticks_sample_hf */
+#define PERIOD_TICKS_SAMPLE_HF(ticks_sample_hf) ((uint64_t)(ticks_sample_hf) * 16000000 / 32768)
+#define PERIOD_CONVERSION_VALID(ticks_sample_hf) (((uint64_t)PERIOD_OSCILLATIONS * PERIOD_TICKS_SAMPLE_HF(ticks_sample_hf) << _SAMPLE_FRAC_BITS) <= UINT32_MAX)
+BUILD_ASSERT(PERIOD_CONVERSION_VALID(RTC_TICKS_SAMPLE_HF), "period conversion overflows");
+#endif
+
+struct _comp_config {
+    uint8_t isource;    // COMP_ISOURCE_ISOURCE_*
+    uint8_t speed;      // COMP_MODE_SP_*
+    uint8_t th_up;
+    uint8_t th_down;
+};
+
+#define _COMP_CONFIG_DEFAULT { \
+    .isource = COMP_ISOURCE_ISOURCE_Ien2mA5, \
+    .speed = COMP_MODE_SP_Low, \
+    .th_up = COMP_TH_OFFSET_HIGH, \
+    .th_down = COMP_TH_OFFSET_LOW, \
+}
+
+struct _tuning {
+    uint8_t activate_margin;
+    uint8_t saturate_margin;
+    uint8_t iir_factor;             // only used with CT_FILTER_IIR_FACTOR_RUNTIME
+    uint16_t ticks_sample_lf;
+    uint16_t ticks_sample_hf;
+    uint16_t ticks_reset_lf;
+    uint16_t ticks_reset_hf;
+    struct _comp_config comp;       // copied to _comp_config when swapped in, which is also changed by autotune
+};
+
+#define _TUNING_DEFAULT { \
+    .activate_margin = CT_ACTIVATE_MARGIN_DEFAULT, \
+    .saturate_margin = CT_SATURATE_MARGIN_DEFAULT, \
+    .iir_factor = CT_FILTER_IIR_FACTOR, \
+    .ticks_sample_lf = RTC_TICKS_SAMPLE, \
+    .ticks_sample_hf = RTC_TICKS_SAMPLE_HF, \
+    .ticks_reset_lf = RTC_TICKS_RESET_LOW_FREQUENCY, \
+    .ticks_reset_hf = RTC_TICKS_RESET_HIGH_FREQUENCY, \
+    .comp = _COMP_CONFIG_DEFAULT, \
+}
 
 static enum _state _state = _STATE_UNINITIALIZED;
-static struct _counter_region _counter_region;
+static struct _comp_config _comp_config = _COMP_CONFIG_DEFAULT;
+#if CONFIG_CAP_TOUCH_LIVE_TUNING
+enum _tuning_update {
+    _TUNING_IDLE = 0,
+    _TUNING_WRITING,    // the inactive buffer is written by cap_touch_tuning_set()
+    _TUNING_PENDING,    // the inactive buffer is swapped in at the next window boundary
+};
+static struct _tuning _tuning_buf[2] = {_TUNING_DEFAULT, _TUNING_DEFAULT};
+static const struct _tuning *_tuning = &_tuning_buf[0]; // only changed from the system work queue
+static atomic_t _tuning_update = ATOMIC_INIT(_TUNING_IDLE);
+#else
+static const struct _tuning _tuning_default = _TUNING_DEFAULT;
+static const struct _tuning *const _tuning = &_tuning_default;
+#endif
+static struct ct_counter_region _counter_region;
 static uint32_t _ppi_isr_always_activate;
 static uint32_t _calibration_period;
 static uint32_t _ppi_calibration_lf_compare;
 static uint32_t _ppi_calibration_hf_compare;
+static uint32_t _ppi_detect_mask = 0; // tasks triggered on touch in _STATE_AUTONOMOUS_LOW_FREQUENCY
+#if CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+static uint32_t _ppi_period_start;
+static uint32_t _ppi_period_capture;
+static uint32_t _ppi_period_stop;
+static struct onoff_client _period_hfxo_client;
+static atomic_t _period_hfxo_requested = ATOMIC_INIT(0); // the client holds a request, which is cancelled or released exactly once
+static atomic_t _period_hfxo_running = ATOMIC_INIT(0);
+#endif
+#if CONFIG_CAP_TOUCH_PROXIMITY
+static uint32_t _ppi_approach;
+static uint32_t _ppi_proximity_mask;
+static cap_touch_approach_event_t _approach_cb = NULL;
+#endif
+#if CONFIG_CAP_TOUCH_OUTPUT_PIN
+static uint32_t _ppi_output_active_mask = 0; // 0 until cap_touch_output_init()
+static volatile uint32_t *_output_task_inactive = NULL;
+#endif
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+static uint32_t _ppi_drift_start;
+static uint32_t _ppi_drift_capture;
+static uint32_t _drift_scale = 1 << 16; // nominal / real window length, 16 fractional bits
+#endif
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+enum _reference_window {
+    _REFERENCE_WINDOW_NONE = 0,
+    _REFERENCE_WINDOW_LF,
+    _REFERENCE_WINDOW_HF,
+};
+static uint32_t _psel_sense;
+static uint32_t _psel_reference = UINT32_MAX; // UINT32_MAX until cap_touch_reference_init()
+static volatile enum _reference_window _reference_window = _REFERENCE_WINDOW_NONE; // kind of the window running with the reference PSEL
+static volatile bool _reference_lf_pending = false;
+static uint32_t _reference_baseline[2]; // LF and HF reference count at scale 1, 0 until the first reference window of the mode
+static uint32_t _reference_scale = 1 << 16; // baseline / current reference count, 16 fractional bits
+#endif
 
 /* buffer samples from ISR to work handler */
+struct _sample {
+    uint16_t value;
+    uint16_t ticks;     // RTC ticks of the sample window
+};
 #define _MSGQ_SIZE 4
-K_MSGQ_DEFINE(_samples_msgq, sizeof(uint16_t), _MSGQ_SIZE, sizeof(uint16_t));
+K_MSGQ_DEFINE(_samples_msgq, sizeof(struct _sample), _MSGQ_SIZE, sizeof(uint16_t));
 
 static void _set_state(enum _state new_state, uint32_t from_bitfield);
+static void _peripherals_quiesce(void);
 
 static void _configure_comparator(void);
+static void _comp_config_apply(void);
 static void _configure_counter(void);
 static void _configure_rtc(void);
 static void _configure_egu(void);
 static void _configure_ppi(void);
+#if CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+static void _configure_period_timer(void);
+static void _period_measure_enable(bool enable);
+static uint16_t _period_sample_get(uint16_t count);
+static void _period_hfxo_started(struct onoff_manager *mgr, struct onoff_client *cli, uint32_t state, int res);
+#endif
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+static void _configure_drift_timer(void);
+static void _drift_measure_start(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(_drift_measure_start_work, _drift_measure_start);
+static void _drift_hfxo_request(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(_drift_hfxo_request_work, _drift_hfxo_request);
+static void _drift_measure_capture(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(_drift_measure_capture_work, _drift_measure_capture);
+static struct onoff_client _drift_hfxo_client;
+static atomic_t _drift_hfxo_requested = ATOMIC_INIT(0); // the client holds a request, which is cancelled or released exactly once
+static atomic_t _drift_window_armed = ATOMIC_INIT(0); // the next sample end captures the drift timer, from the RTC interrupt
+static void _drift_hfxo_started(struct onoff_manager *mgr, struct onoff_client *cli, uint32_t state, int res);
+static void _drift_hfxo_release(void);
+static void _drift_window_end(void);
+static uint32_t _drift_normalise(uint32_t count);
+static uint32_t _drift_denormalise(uint32_t count);
+#endif
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+static void _reference_window_begin(enum _reference_window kind);
+static void _reference_window_end(uint32_t count);
+static void _reference_window_cancel(void);
+static void _reference_lf_request(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(_reference_lf_request_work, _reference_lf_request);
+static void _reference_lf_update(struct k_work *work);
+static K_WORK_DEFINE(_reference_lf_update_work, _reference_lf_update);
+static uint32_t _reference_normalise(uint32_t count);
+static uint32_t _reference_denormalise(uint32_t count);
+#endif
+#if CONFIG_CAP_TOUCH_PROXIMITY
+static void _configure_proximity(void);
+static void _proximity_enable(bool enable);
+static void _approach_notify(struct k_work *work);
+static K_WORK_DEFINE(_approach_notify_work, _approach_notify);
+#endif
 
 #define _CALIBRATION_START_DELAY_MS 10
 #define _CALIBRATION_SAMPLE_CAPTURE_PERIOD_MAX_SEC (2*60)
@@ -123,21 +394,88 @@ static K_WORK_DELAYABLE_DEFINE(_calibration_start_work, _calibration_start);
 static void _calibration_reset(void);
 static void _calibration_capture(struct k_work *work);
 static K_WORK_DELAYABLE_DEFINE(_calibration_capture_work, _calibration_capture);
+static bool _calibration_start_pending = false; // _calibration_start_work was cancelled by _STATE_SUSPENDED
+
+#if CONFIG_CAP_TOUCH_AUTOTUNE
+#define _AUTOTUNE_SAMPLES_DISCARD 2 // windows overlapping the setting change
+#define _AUTOTUNE_SAMPLE_TIMEOUT_MS 100 // allows a few samples discarded by radio activity
+#define _AUTOTUNE_HF_COUNT_MAX ((UINT16_MAX >> _SAMPLE_FRAC_BITS) * 3 / 4) // headroom for the count increasing after tuning
+static bool _comp_tuned = false;
+static bool _autotune_start_pending = false; // cap_touch_start() called, _STATE_AUTONOMOUS_LOW_FREQUENCY follows the autotune
+static struct {
+    size_t candidate;
+    uint32_t samples;
+    struct ct_autotune_stats stats;
+    struct _comp_config config_prev;
+    struct _comp_config config_best;
+    uint64_t score_best;
+} _autotune;
+static struct _comp_config _autotune_candidate(size_t idx);
+static uint32_t _autotune_current_na(const struct _comp_config *config);
+static void _autotune_candidate_begin(void);
+static void _autotune_process(void);
+static void _autotune_finish(int err);
+static void _autotune_timeout(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(_autotune_timeout_work, _autotune_timeout);
+#endif
+
+#if CONFIG_CAP_TOUCH_LIVE_TUNING || CONFIG_CAP_TOUCH_DIFFERENTIAL || CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+static void _rtc_irq(void);
+#endif
+#if CONFIG_CAP_TOUCH_LIVE_TUNING
+static bool _tuning_swap(void);
+static void _tuning_swap_at_boundary(struct k_work *work);
+static K_WORK_DEFINE(_tuning_swap_work, _tuning_swap_at_boundary);
+static int _tuning_write(const struct cap_touch_tuning *tuning);
+static int _tuning_validate(const struct cap_touch_tuning *tuning);
+#endif
+
+static uint32_t _chain_incidents = 0;
+static bool _chain_rtc_running(void);
+static void _chain_recover(const char *reason);
 
 static uint16_t _calibration_buf[5];
 static uint8_t _calibration_buf_idx = 0;
     
 static void _egu_irq(void);
 
+static bool _sample_radio_tainted(void);
+static void _sample_jitter_apply(void);
+#if CONFIG_CAP_TOUCH_HF_ADAPTIVE_WINDOW
+#define _NOISE_FRAC_BITS 4
+static volatile uint16_t _sample_window_ticks; // RTC CC of the next HF sample end, applied by the sample interrupt
+static atomic_t _sample_window_full_pending = ATOMIC_INIT(0); // set by the calibration capture, the next HF window is full
+static uint32_t _noise_var = 0; // variance of a full HF window sample, _NOISE_FRAC_BITS fractional bits. 0 until estimated
+static struct _sample _noise_prev; // ticks is 0 if there is no previous sample in this HF period
+static void _sample_window_apply(void);
+static void _sample_noise_update(struct _sample sample);
+static uint16_t _sample_window_calc(uint16_t filtered);
+#endif
+
 static void _counter_region_set(uint32_t calibration_point);
+static void _active_trigger_update(void);
 
 static void _sample_process(struct k_work *work);
 static K_WORK_DEFINE(_sample_process_work, _sample_process);
+static uint16_t _sample_filtered; // latest output of the filter chain
+static bool _filter_seed_pending = false; // the first sample of a _STATE_HIGH_FREQUENCY period restarts the filter chain
+static uint8_t _output_prev = 0;
+
+#if CONFIG_CAP_TOUCH_STUCK_TIMEOUT_SEC > 0
+static void _stuck_rebaseline(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(_stuck_rebaseline_work, _stuck_rebaseline);
+#endif
+
+#if CONFIG_CAP_TOUCH_ZBUS
+ZBUS_CHAN_DEFINE(cap_touch_chan_event, struct cap_touch_msg, NULL, NULL, ZBUS_OBSERVERS_EMPTY, ZBUS_MSG_INIT(0));
+ZBUS_CHAN_DEFINE(cap_touch_chan_level, struct cap_touch_msg, NULL, NULL, ZBUS_OBSERVERS_EMPTY, ZBUS_MSG_INIT(0));
+static void _msg_publish(uint8_t level);
+#endif
 
 static cap_touch_event_t _cb;
 void cap_touch_init(cap_touch_event_t event_cb, uint32_t psel_comp, uint32_t psel_pin) {
     __ASSERT_NO_MSG(_state == _STATE_UNINITIALIZED);
-    __ASSERT_NO_MSG(event_cb != NULL);
+    __ASSERT_NO_MSG(event_cb != NULL || IS_ENABLED(CONFIG_CAP_TOUCH_ZBUS));
     ARG_UNUSED(psel_pin);
     LOG_INF("cap_touch_init");
 
@@ -149,18 +487,141 @@ void cap_touch_init(cap_touch_event_t event_cb, uint32_t psel_comp, uint32_t pse
 
     _cb = event_cb;
     NRF_COMP->PSEL = psel_comp;
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+    _psel_sense = psel_comp;
+#endif
+
+#if CONFIG_CAP_TOUCH_AUTOTUNE_PERSIST || CONFIG_CAP_TOUCH_LIVE_TUNING_PERSIST
+    int err = settings_subsys_init();
+    if (!err) err = settings_load_subtree("cap_touch");
+    LOG_WRN_IF(err, "failed loading tuned settings: %d", err);
+#endif
+#if CONFIG_CAP_TOUCH_RECORDER
+    const uint32_t sample_period_us = (uint64_t)RTC_TICKS_RESET_HIGH_FREQUENCY * 1000000 / 32768;
+    int recorder_err = ct_recorder_init(sample_period_us, RTC_TICKS_SAMPLE, RTC_TICKS_SAMPLE_HF);
+    LOG_WRN_IF(recorder_err, "recorder not available: %d", recorder_err);
+#endif
 
     _set_state(_STATE_OFF, 1 << _STATE_UNINITIALIZED);
 }
 
+void cap_touch_detect_task_connect(volatile uint32_t *task) {
+    __ASSERT_NO_MSG(_state == _STATE_OFF);
+    __ASSERT_NO_MSG(task != NULL);
+    const uint32_t ppi_detect = ppi_connect(&EGU_SELECT->EVENTS_TRIGGERED[EGU_ACTIVATE_IDX], task);
+    NRF_PPI->CHENCLR = 1 << ppi_detect; // enabled with _STATE_AUTONOMOUS_LOW_FREQUENCY
+    _ppi_detect_mask |= 1 << ppi_detect;
+}
+
+#if CONFIG_CAP_TOUCH_PROXIMITY
+void cap_touch_approach_init(cap_touch_approach_event_t event_cb) {
+    __ASSERT_NO_MSG(_state == _STATE_OFF);
+    __ASSERT_NO_MSG(event_cb != NULL);
+    _approach_cb = event_cb;
+}
+#else
+void cap_touch_approach_init(cap_touch_approach_event_t event_cb) {
+    LOG_WRN("CONFIG_CAP_TOUCH_PROXIMITY not enabled");
+}
+#endif
+
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+void cap_touch_reference_init(uint32_t psel_reference) {
+    __ASSERT_NO_MSG(_state == _STATE_OFF);
+    LOG_INF("cap_touch_reference_init");
+    _psel_reference = psel_reference;
+}
+#else
+void cap_touch_reference_init(uint32_t psel_reference) {
+    LOG_WRN("CONFIG_CAP_TOUCH_DIFFERENTIAL not enabled");
+}
+#endif
+
+#if CONFIG_CAP_TOUCH_OUTPUT_PIN
+void cap_touch_output_init(uint32_t pin, int polarity) {
+    __ASSERT_NO_MSG(_state == _STATE_OFF);
+    __ASSERT_NO_MSG(pin < 32);
+    __ASSERT_NO_MSG(polarity == 0 || polarity == 1);
+    LOG_INF("cap_touch_output_init");
+
+    NRF_GPIOTE->CONFIG[GPIOTE_OUTPUT_IDX] = (GPIOTE_CONFIG_MODE_Task << GPIOTE_CONFIG_MODE_Pos) | (pin << GPIOTE_CONFIG_PSEL_Pos) |
+        (GPIOTE_CONFIG_POLARITY_Toggle << GPIOTE_CONFIG_POLARITY_Pos) |
+        ((polarity ? GPIOTE_CONFIG_OUTINIT_Low : GPIOTE_CONFIG_OUTINIT_High) << GPIOTE_CONFIG_OUTINIT_Pos);
+    volatile uint32_t *task_active = polarity ? &NRF_GPIOTE->TASKS_SET[GPIOTE_OUTPUT_IDX] : &NRF_GPIOTE->TASKS_CLR[GPIOTE_OUTPUT_IDX];
+    _output_task_inactive = polarity ? &NRF_GPIOTE->TASKS_CLR[GPIOTE_OUTPUT_IDX] : &NRF_GPIOTE->TASKS_SET[GPIOTE_OUTPUT_IDX];
+
+    // active on the same event as the CPU wakeup, inactive when the active trigger is reached. The latter is only enabled in _STATE_AUTONOMOUS_LOW_FREQUENCY
+    _ppi_output_active_mask = 1 << ppi_connect(&EGU_SELECT->EVENTS_TRIGGERED[EGU_ACTIVATE_IDX], task_active);
+    ppi_fork(_ppi_isr_always_activate, _output_task_inactive);
+}
+#else
+void cap_touch_output_init(uint32_t pin, int polarity) {
+    LOG_WRN("CONFIG_CAP_TOUCH_OUTPUT_PIN not enabled");
+}
+#endif
+
+uint32_t cap_touch_incidents_get(void) {
+    return _chain_incidents;
+}
+
 void cap_touch_start(void) {
     LOG_INF("cap_touch_start");
+#if CONFIG_CAP_TOUCH_AUTOTUNE
+    if (_state == _STATE_AUTOTUNE) {
+        _autotune_start_pending = true;
+        return;
+    }
+    if (!_comp_tuned) {
+        _autotune_start_pending = true;
+        int err = cap_touch_autotune();
+        if (!err) return; // started by _autotune_finish()
+        _autotune_start_pending = false;
+        LOG_WRN("autotune failed, using default COMP setting: %d", err);
+    }
+#endif
     _set_state(_STATE_AUTONOMOUS_LOW_FREQUENCY, (1 << _STATE_OFF));
 }
 
 void cap_touch_stop(void) {
     LOG_INF("cap_touch_stop");
-    _set_state(_STATE_OFF, (1 << _STATE_AUTONOMOUS_LOW_FREQUENCY) || (1 << _STATE_HIGH_FREQUENCY));
+#if CONFIG_CAP_TOUCH_AUTOTUNE
+    if (_state == _STATE_AUTOTUNE) {
+        _autotune_start_pending = false;
+        _autotune_finish(-ECANCELED);
+        return;
+    }
+#endif
+    _set_state(_STATE_OFF, (1 << _STATE_AUTONOMOUS_LOW_FREQUENCY) | (1 << _STATE_HIGH_FREQUENCY) | (1 << _STATE_SUSPENDED));
+}
+
+void cap_touch_suspend(void) {
+    LOG_DBG("cap_touch_suspend");
+#if CONFIG_CAP_TOUCH_AUTOTUNE
+    if (_state == _STATE_AUTOTUNE) {
+        _autotune_start_pending = false; // ends in _STATE_OFF, started by the resume
+        return;
+    }
+#endif
+    _set_state(_STATE_SUSPENDED, (1 << _STATE_AUTONOMOUS_LOW_FREQUENCY) | (1 << _STATE_HIGH_FREQUENCY));
+    if (_state != _STATE_SUSPENDED) return;
+
+    // a touch can end while suspended, without a wakeup to report it
+#if CONFIG_CAP_TOUCH_ZBUS
+    _msg_publish(0);
+#endif
+    if (_output_prev != 0) {
+        _output_prev = 0;
+        if (_cb) _cb(0);
+    }
+}
+
+void cap_touch_resume(void) {
+    LOG_DBG("cap_touch_resume");
+    if (_state == _STATE_OFF || _state == _STATE_AUTOTUNE) {
+        cap_touch_start();
+        return;
+    }
+    _set_state(_STATE_AUTONOMOUS_LOW_FREQUENCY, (1 << _STATE_SUSPENDED));
 }
 
 /* state machine is implemented such that it's valid to call it at any time, but requires it to be called from only a single thread */
@@ -186,38 +647,97 @@ static void _set_state(enum _state new_state, uint32_t from_bitfield) {
             _configure_rtc();
             _configure_egu();
             _configure_ppi();
+#if CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+            _configure_period_timer();
+#endif
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+            _configure_drift_timer();
+#endif
+#if CONFIG_CAP_TOUCH_PROXIMITY
+            _configure_proximity();
+#endif
             break;
 
         case _STATE_TRANSITION(_STATE_HIGH_FREQUENCY, _STATE_OFF):
         case _STATE_TRANSITION(_STATE_AUTONOMOUS_LOW_FREQUENCY, _STATE_OFF):
+        case _STATE_TRANSITION(_STATE_AUTOTUNE, _STATE_OFF):
             LOG_INF("STATE_OFF");
-            k_work_cancel_delayable(&_calibration_capture_work);
-            RTC_SELECT->TASKS_STOP = 1;
-            COUNTER_SELECT->TASKS_STOP = 1;
-            RTC_SELECT->TASKS_CLEAR = 1;
-            COUNTER_SELECT->TASKS_CLEAR = 1;
-            NRF_COMP->TASKS_STOP = 1;
-            NRF_COMP->ENABLE = COMP_ENABLE_ENABLE_Disabled << COMP_ENABLE_ENABLE_Pos;
+            _calibration_start_pending = false;
+            k_work_cancel_delayable(&_calibration_start_work);
+            _peripherals_quiesce();
+            break;
+
+        case _STATE_TRANSITION(_STATE_SUSPENDED, _STATE_OFF):
+            LOG_INF("STATE_OFF");
+            _calibration_start_pending = false; // the peripherals are already stopped
+            break;
+
+        case _STATE_TRANSITION(_STATE_HIGH_FREQUENCY, _STATE_SUSPENDED):
+        case _STATE_TRANSITION(_STATE_AUTONOMOUS_LOW_FREQUENCY, _STATE_SUSPENDED):
+            LOG_INF("STATE_SUSPENDED");
+            _calibration_start_pending = k_work_delayable_is_pending(&_calibration_start_work);
+            k_work_cancel_delayable(&_calibration_start_work);
+            _peripherals_quiesce();
+            k_msgq_purge(&_samples_msgq); // windows before the suspend, the sample process work ignores them
             break;
         
         case _STATE_TRANSITION(_STATE_OFF, _STATE_AUTONOMOUS_LOW_FREQUENCY):
+            _counter_region_set(0); // initial trigger point
+            _calibration_start_pending = true;
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+            _reference_baseline[0] = 0;
+            _reference_baseline[1] = 0;
+            _reference_scale = 1 << 16;
+#endif
+        case _STATE_TRANSITION(_STATE_SUSPENDED, _STATE_AUTONOMOUS_LOW_FREQUENCY):
+#if CONFIG_CAP_TOUCH_LIVE_TUNING
+            (void)_tuning_swap(); // update made while stopped, there is no window boundary interrupt without the RTC
+#endif
             NRF_COMP->ENABLE = COMP_ENABLE_ENABLE_Enabled << COMP_ENABLE_ENABLE_Pos;
             NRF_COMP->TASKS_START = 1;
             COUNTER_SELECT->TASKS_START = 1;
             RTC_SELECT->TASKS_START = 1;
-            _counter_region_set(0); // initial trigger point
-            k_work_schedule(&_calibration_start_work, K_MSEC(_CALIBRATION_START_DELAY_MS)); // wait until system is stable
+            // after a suspend, the kept calibration continues at its current period
+            if (_calibration_start_pending) {
+                _calibration_start_pending = false;
+                k_work_schedule(&_calibration_start_work, K_MSEC(_CALIBRATION_START_DELAY_MS)); // wait until system is stable
+            } else {
+                k_work_schedule(&_calibration_capture_work, K_SECONDS(_calibration_period));
+            }
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+            k_work_schedule(&_drift_measure_start_work, K_NO_WAIT);
+#endif
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+            if (_psel_reference != UINT32_MAX) k_work_schedule(&_reference_lf_request_work, K_NO_WAIT);
+#endif
         case _STATE_TRANSITION(_STATE_HIGH_FREQUENCY, _STATE_AUTONOMOUS_LOW_FREQUENCY):
             LOG_INF("STATE_LOW_FREQUENCY");
-
-            // operation parameters
-            RTC_SELECT->CC[RTC_CC_SAMPLE_END_IDX] = RTC_TICKS_SAMPLE + RTC_CC_SAMPLE_START_VALUE;
-            RTC_SELECT->CC[RTC_CC_RESET_IDX] = RTC_TICKS_RESET_LOW_FREQUENCY;
+#if CONFIG_CAP_TOUCH_STUCK_TIMEOUT_SEC > 0
+            k_work_cancel_delayable(&_stuck_rebaseline_work);
+#endif
+#if CONFIG_CAP_TOUCH_RECORDER
+            ct_recorder_push(0, 0, 0, CT_RECORD_MODE_LOW_FREQUENCY); // mode change marker
+#endif
 
             // activate autonompus mode and calibration to LF register
             NRF_PPI->CHENSET = 1 << _ppi_isr_always_activate;
             NRF_PPI->CHENSET = 1 << _ppi_calibration_lf_compare;
             NRF_PPI->CHENCLR = 1 << _ppi_calibration_hf_compare;
+            NRF_PPI->CHENSET = _ppi_detect_mask;
+
+            // operation parameters, after the activate channel is enabled which stops the HF sample interrupt from changing them
+            RTC_SELECT->CC[RTC_CC_SAMPLE_END_IDX] = _tuning->ticks_sample_lf + RTC_CC_SAMPLE_START_VALUE;
+            RTC_SELECT->CC[RTC_CC_RESET_IDX] = _tuning->ticks_reset_lf;
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+            _reference_window_cancel(); // after the activate channel is enabled, which stops new HF reference windows
+#endif
+#if CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+            _period_measure_enable(false);
+#endif
+#if CONFIG_CAP_TOUCH_PROXIMITY
+            _proximity_enable(true);
+#endif
+            _active_trigger_update();
 
             // restart
             RTC_SELECT->TASKS_CLEAR = 1;
@@ -225,18 +745,53 @@ static void _set_state(enum _state new_state, uint32_t from_bitfield) {
 
         case _STATE_TRANSITION(_STATE_AUTONOMOUS_LOW_FREQUENCY, _STATE_HIGH_FREQUENCY):
             LOG_INF("STATE_HIGH_FREQUENCY");
+            _filter_seed_pending = true; // the filter holds no touch samples of the previous HF period
             // deactivate autonomous mode and calibration to HF register
             NRF_PPI->CHENCLR = 1 << _ppi_isr_always_activate;
             NRF_PPI->CHENSET = 1 << _ppi_calibration_hf_compare;
             NRF_PPI->CHENCLR = 1 << _ppi_calibration_lf_compare;
+            NRF_PPI->CHENCLR = _ppi_detect_mask;
+#if CONFIG_CAP_TOUCH_PROXIMITY
+            _proximity_enable(false);
+#endif
 
             // operation parameters
-            RTC_SELECT->CC[RTC_CC_SAMPLE_END_IDX] = RTC_TICKS_SAMPLE_HF;
-            RTC_SELECT->CC[RTC_CC_RESET_IDX] = RTC_TICKS_RESET_HIGH_FREQUENCY;
+            RTC_SELECT->CC[RTC_CC_SAMPLE_END_IDX] = _tuning->ticks_sample_hf;
+            RTC_SELECT->CC[RTC_CC_RESET_IDX] = _tuning->ticks_reset_hf;
+#if CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+            _period_measure_enable(true);
+#endif
+#if CONFIG_CAP_TOUCH_HF_ADAPTIVE_WINDOW
+            // the first window after the wakeup is the full window, the noise estimate is kept from the previous HF period
+            _sample_window_ticks = _tuning->ticks_sample_hf;
+            _noise_prev.ticks = 0;
+#endif
+#if CONFIG_CAP_TOUCH_STUCK_TIMEOUT_SEC > 0
+            k_work_schedule(&_stuck_rebaseline_work, K_SECONDS(CONFIG_CAP_TOUCH_STUCK_TIMEOUT_SEC));
+#endif
 
             // restart
             RTC_SELECT->TASKS_CLEAR = 1;
             break;
+
+        case _STATE_TRANSITION(_STATE_OFF, _STATE_AUTOTUNE):
+            LOG_INF("STATE_AUTOTUNE");
+#if CONFIG_CAP_TOUCH_LIVE_TUNING
+            (void)_tuning_swap();
+#endif
+            // HF windows with an interrupt for every sample, without calibration
+            NRF_PPI->CHENCLR = (1 << _ppi_isr_always_activate) | (1 << _ppi_calibration_lf_compare) | (1 << _ppi_calibration_hf_compare);
+#if CONFIG_CAP_TOUCH_OUTPUT_PIN
+            NRF_PPI->CHENCLR = _ppi_output_active_mask; // every sample interrupts, no touch output
+#endif
+            RTC_SELECT->CC[RTC_CC_SAMPLE_END_IDX] = _tuning->ticks_sample_hf;
+            RTC_SELECT->CC[RTC_CC_RESET_IDX] = RTC_TICKS_RESET_AUTOTUNE(_tuning->ticks_sample_hf);
+
+            NRF_COMP->ENABLE = COMP_ENABLE_ENABLE_Enabled << COMP_ENABLE_ENABLE_Pos;
+            NRF_COMP->TASKS_START = 1;
+            COUNTER_SELECT->TASKS_START = 1;
+            RTC_SELECT->TASKS_START = 1;
+            break;
         
         // not valid transitions (not including unititialized & not supported)
         default:
@@ -246,16 +801,353 @@ static void _set_state(enum _state new_state, uint32_t from_bitfield) {
     _state = new_state;
 }
 
+/* stop the measurement from any running state, without changing calibration, thresholds or filter state */
+static void _peripherals_quiesce(void) {
+    k_work_cancel_delayable(&_calibration_capture_work);
+#if CONFIG_CAP_TOUCH_STUCK_TIMEOUT_SEC > 0
+    k_work_cancel_delayable(&_stuck_rebaseline_work);
+#endif
+    RTC_SELECT->TASKS_STOP = 1;
+    COUNTER_SELECT->TASKS_STOP = 1;
+    RTC_SELECT->TASKS_CLEAR = 1;
+    COUNTER_SELECT->TASKS_CLEAR = 1;
+    NRF_COMP->TASKS_STOP = 1;
+    NRF_COMP->ENABLE = COMP_ENABLE_ENABLE_Disabled << COMP_ENABLE_ENABLE_Pos;
+    NRF_PPI->CHENCLR = _ppi_detect_mask;
+#if CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+    _period_measure_enable(false);
+#endif
+#if CONFIG_CAP_TOUCH_PROXIMITY
+    _proximity_enable(false);
+#endif
+#if CONFIG_CAP_TOUCH_OUTPUT_PIN
+    if (_output_task_inactive) *_output_task_inactive = 1;
+    NRF_PPI->CHENSET = _ppi_output_active_mask; // disabled in _STATE_AUTOTUNE
+#endif
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+    k_work_cancel_delayable(&_drift_measure_start_work);
+    k_work_cancel_delayable(&_drift_hfxo_request_work);
+    k_work_cancel_delayable(&_drift_measure_capture_work);
+    atomic_set(&_drift_window_armed, 0);
+    NRF_PPI->CHENCLR = (1 << _ppi_drift_start) | (1 << _ppi_drift_capture);
+    DRIFT_TIMER_SELECT->TASKS_STOP = 1;
+    _drift_hfxo_release();
+#endif
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+    k_work_cancel_delayable(&_reference_lf_request_work);
+    _reference_window_cancel();
+#endif
+}
+
 static void _configure_comparator() {
-    #define COMP_TH_MAX 63
-    #define COMP_TH_OFFSET_LOW 5
-    #define COMP_TH_OFFSET_HIGH 30
-    BUILD_ASSERT(COMP_TH_OFFSET_HIGH <= COMP_TH_MAX && COMP_TH_OFFSET_LOW <= COMP_TH_MAX && COMP_TH_OFFSET_HIGH > COMP_TH_OFFSET_LOW, "COMP offsets invalid");
     NRF_COMP->REFSEL = COMP_REFSEL_REFSEL_VDD << COMP_REFSEL_REFSEL_Pos;
-    NRF_COMP->TH = ((COMP_TH_OFFSET_HIGH) << COMP_TH_THUP_Pos) | (COMP_TH_OFFSET_LOW << COMP_TH_THDOWN_Pos);
-    NRF_COMP->MODE = (COMP_MODE_MAIN_SE << COMP_MODE_MAIN_Pos) | (COMP_MODE_SP_Low << COMP_MODE_SP_Pos);
-    NRF_COMP->ISOURCE = COMP_ISOURCE_ISOURCE_Ien2mA5 << COMP_ISOURCE_ISOURCE_Pos;
+    _comp_config_apply();
+}
+
+static void _comp_config_apply(void) {
+    NRF_COMP->TH = (_comp_config.th_up << COMP_TH_THUP_Pos) | (_comp_config.th_down << COMP_TH_THDOWN_Pos);
+    NRF_COMP->MODE = (COMP_MODE_MAIN_SE << COMP_MODE_MAIN_Pos) | (_comp_config.speed << COMP_MODE_SP_Pos);
+    NRF_COMP->ISOURCE = _comp_config.isource << COMP_ISOURCE_ISOURCE_Pos;
+}
+
+#if CONFIG_CAP_TOUCH_AUTOTUNE
+/* candidates are all combinations of these */
+static const uint8_t _AUTOTUNE_ISOURCE[] = {COMP_ISOURCE_ISOURCE_Ien2mA5, COMP_ISOURCE_ISOURCE_Ien5mA, COMP_ISOURCE_ISOURCE_Ien10mA};
+static const uint8_t _AUTOTUNE_SPEED[] = {COMP_MODE_SP_Low, COMP_MODE_SP_Normal, COMP_MODE_SP_High};
+static const uint8_t _AUTOTUNE_TH[][2] = {{COMP_TH_OFFSET_HIGH, COMP_TH_OFFSET_LOW}, {20, 10}, {45, 5}}; // up, down
+#define _AUTOTUNE_CANDIDATES (ARRAY_SIZE(_AUTOTUNE_ISOURCE) * ARRAY_SIZE(_AUTOTUNE_SPEED) * ARRAY_SIZE(_AUTOTUNE_TH))
+
+int cap_touch_autotune(void) {
+    LOG_INF("cap_touch_autotune");
+    _set_state(_STATE_AUTOTUNE, 1 << _STATE_OFF);
+    if (_state != _STATE_AUTOTUNE) return -EBUSY;
+
+    _autotune.candidate = 0;
+    _autotune.config_prev = _comp_config;
+    _autotune.config_best = _comp_config;
+    _autotune.score_best = 0;
+    _autotune_candidate_begin();
+    return 0;
+}
+
+/* ends _STATE_AUTOTUNE with the best candidate, or the previous setting on error */
+static void _autotune_finish(int err) {
+    k_work_cancel_delayable(&_autotune_timeout_work);
+    _set_state(_STATE_OFF, 1 << _STATE_AUTOTUNE);
+
+    if (!err && _autotune.score_best == 0) err = -ERANGE;
+    _comp_config = err ? _autotune.config_prev : _autotune.config_best;
+    _comp_config_apply();
+    if (err) {
+        LOG_ERR("autotune failed: %d", err);
+    } else {
+        LOG_INF("autotuned: isource %d, speed %d, th %d/%d", _comp_config.isource, _comp_config.speed, _comp_config.th_up, _comp_config.th_down);
+        _comp_tuned = true;
+#if CONFIG_CAP_TOUCH_AUTOTUNE_PERSIST
+        int save_err = settings_save_one("cap_touch/comp", &_comp_config, sizeof(_comp_config));
+        LOG_WRN_IF(save_err, "failed storing tuned COMP setting: %d", save_err);
+#endif
+    }
+
+    if (_autotune_start_pending) {
+        _autotune_start_pending = false;
+        _set_state(_STATE_AUTONOMOUS_LOW_FREQUENCY, (1 << _STATE_OFF));
+    }
+}
+
+static struct _comp_config _autotune_candidate(size_t idx) {
+    const size_t th = idx % ARRAY_SIZE(_AUTOTUNE_TH);
+    idx /= ARRAY_SIZE(_AUTOTUNE_TH);
+    const size_t speed = idx % ARRAY_SIZE(_AUTOTUNE_SPEED);
+    idx /= ARRAY_SIZE(_AUTOTUNE_SPEED);
+    return (struct _comp_config){
+        .isource = _AUTOTUNE_ISOURCE[idx],
+        .speed = _AUTOTUNE_SPEED[speed],
+        .th_up = _AUTOTUNE_TH[th][0],
+        .th_down = _AUTOTUNE_TH[th][1],
+    };
+}
+
+/* average current while sampling, approximate figures from the product specification. Only the ratios between candidates matter */
+static uint32_t _autotune_current_na(const struct _comp_config *config) {
+    const uint32_t isource_na = config->isource == COMP_ISOURCE_ISOURCE_Ien10mA ? 10000 : config->isource == COMP_ISOURCE_ISOURCE_Ien5mA ? 5000 : 2500;
+    const uint32_t comp_na = config->speed == COMP_MODE_SP_High ? 60000 : config->speed == COMP_MODE_SP_Normal ? 30000 : 10000;
+    return isource_na + comp_na;
+}
+
+/* switch to the current candidate, its samples are collected by _autotune_process() */
+static void _autotune_candidate_begin(void) {
+    _comp_config = _autotune_candidate(_autotune.candidate);
+    NRF_COMP->ENABLE = COMP_ENABLE_ENABLE_Disabled << COMP_ENABLE_ENABLE_Pos;
+    _comp_config_apply();
+    NRF_COMP->ENABLE = COMP_ENABLE_ENABLE_Enabled << COMP_ENABLE_ENABLE_Pos;
+    k_msgq_purge(&_samples_msgq);
+
+    _autotune.samples = 0;
+    _autotune.stats = (struct ct_autotune_stats){0};
+    k_work_reschedule(&_autotune_timeout_work, K_MSEC(_AUTOTUNE_SAMPLE_TIMEOUT_MS));
+}
+
+/* called from _sample_process() in _STATE_AUTOTUNE */
+static void _autotune_process(void) {
+    struct _sample sample;
+    while (k_msgq_get(&_samples_msgq, &sample, K_NO_WAIT) == 0) {
+        k_work_reschedule(&_autotune_timeout_work, K_MSEC(_AUTOTUNE_SAMPLE_TIMEOUT_MS));
+        if (_autotune.samples++ < _AUTOTUNE_SAMPLES_DISCARD) continue;
+        ct_autotune_stats_add(&_autotune.stats, sample.value);
+        if (_autotune.stats.n < CONFIG_CAP_TOUCH_AUTOTUNE_SAMPLES) continue;
+
+        const uint32_t mean = ct_autotune_stats_mean(&_autotune.stats);
+        const uint32_t count_lf = mean * _tuning->ticks_sample_lf / _tuning->ticks_sample_hf;
+        const uint64_t score = ct_autotune_score(&_autotune.stats, _autotune_current_na(&_comp_config));
+        LOG_DBG("isource %d, speed %d, th %d/%d: mean %d, variance12 %d, lf %d, score %d", _comp_config.isource, _comp_config.speed,
+            _comp_config.th_up, _comp_config.th_down, mean, (uint32_t)ct_autotune_stats_variance12(&_autotune.stats), count_lf, (uint32_t)score);
+        if (count_lf >= CONFIG_CAP_TOUCH_AUTOTUNE_LF_COUNT_MIN && mean <= _AUTOTUNE_HF_COUNT_MAX && score > _autotune.score_best) {
+            _autotune.score_best = score;
+            _autotune.config_best = _comp_config;
+        }
+
+        if (++_autotune.candidate == _AUTOTUNE_CANDIDATES) {
+            _autotune_finish(0);
+        } else {
+            _autotune_candidate_begin();
+        }
+        return; // the remaining samples are from the previous candidate, purged
+    }
+}
+
+static void _autotune_timeout(struct k_work *work) {
+    if (_state != _STATE_AUTOTUNE) return;
+    LOG_ERR("no sample");
+    _autotune_finish(-ETIMEDOUT);
+}
+
+#if CONFIG_CAP_TOUCH_AUTOTUNE_PERSIST
+static int _settings_comp_set(size_t len, settings_read_cb read_cb, void *cb_arg) {
+    if (len != sizeof(struct _comp_config)) return -EINVAL;
+
+    struct _comp_config config;
+    if (read_cb(cb_arg, &config, sizeof(config)) != sizeof(config)) return -EIO;
+    if (config.th_up > COMP_TH_MAX || config.th_down >= config.th_up || config.isource == COMP_ISOURCE_ISOURCE_Off ||
+        config.speed > COMP_MODE_SP_High) return -EINVAL;
+
+    _comp_config = config;
+    _comp_tuned = true;
+    LOG_INF("loaded tuned COMP setting: isource %d, speed %d, th %d/%d", config.isource, config.speed, config.th_up, config.th_down);
+    return 0;
+}
+#endif
+#else
+int cap_touch_autotune(void) {
+    return -ENOTSUP;
+}
+#endif
+
+#if CONFIG_CAP_TOUCH_LIVE_TUNING
+void cap_touch_tuning_get(struct cap_touch_tuning *tuning) {
+    __ASSERT_NO_MSG(tuning != NULL);
+    const struct _tuning *current = _tuning;
+    *tuning = (struct cap_touch_tuning){
+        .activate_margin = current->activate_margin,
+        .saturate_margin = current->saturate_margin,
+        .iir_factor = current->iir_factor,
+        .comp_isource = _comp_config.isource,
+        .comp_speed = _comp_config.speed,
+        .comp_th_up = _comp_config.th_up,
+        .comp_th_down = _comp_config.th_down,
+        .ticks_sample_lf = current->ticks_sample_lf,
+        .ticks_sample_hf = current->ticks_sample_hf,
+        .ticks_reset_lf = current->ticks_reset_lf,
+        .ticks_reset_hf = current->ticks_reset_hf,
+    };
+}
+
+int cap_touch_tuning_set(const struct cap_touch_tuning *tuning) {
+    __ASSERT_NO_MSG(tuning != NULL);
+    int err = _tuning_write(tuning);
+    if (err) return err;
+
+#if CONFIG_CAP_TOUCH_LIVE_TUNING_PERSIST
+    err = settings_save_one("cap_touch/tuning", tuning, sizeof(*tuning));
+    LOG_WRN_IF(err, "failed storing tuning: %d", err);
+#endif
+    return 0;
+}
+
+/* write the inactive buffer, which is not read until it is swapped in */
+static int _tuning_write(const struct cap_touch_tuning *tuning) {
+    if (_tuning_validate(tuning)) return -EINVAL;
+    if (!atomic_cas(&_tuning_update, _TUNING_IDLE, _TUNING_WRITING)) return -EBUSY;
+
+    struct _tuning *next = _tuning == &_tuning_buf[0] ? &_tuning_buf[1] : &_tuning_buf[0];
+    *next = (struct _tuning){
+        .activate_margin = tuning->activate_margin,
+        .saturate_margin = tuning->saturate_margin,
+        .iir_factor = tuning->iir_factor,
+        .ticks_sample_lf = tuning->ticks_sample_lf,
+        .ticks_sample_hf = tuning->ticks_sample_hf,
+        .ticks_reset_lf = tuning->ticks_reset_lf,
+        .ticks_reset_hf = tuning->ticks_reset_hf,
+        .comp = {
+            .isource = tuning->comp_isource,
+            .speed = tuning->comp_speed,
+            .th_up = tuning->comp_th_up,
+            .th_down = tuning->comp_th_down,
+        },
+    };
+    atomic_set(&_tuning_update, _TUNING_PENDING);
+
+    // swapped after the next sample window, or by the start from _STATE_OFF
+    RTC_SELECT->INTENSET = RTC_INTENSET_COMPARE1_Msk;
+    return 0;
+}
+
+static int _tuning_validate(const struct cap_touch_tuning *tuning) {
+    const bool margins = tuning->activate_margin > tuning->saturate_margin;
+    const bool comp = tuning->comp_isource != COMP_ISOURCE_ISOURCE_Off && tuning->comp_isource <= COMP_ISOURCE_ISOURCE_Ien10mA &&
+        tuning->comp_speed <= COMP_MODE_SP_High && tuning->comp_th_up <= COMP_TH_MAX && tuning->comp_th_down < tuning->comp_th_up;
+    // the same constraints as the defaults, with the margin of _tuning_swap_at_boundary() between windows
+    bool windows = tuning->ticks_sample_lf > 0 && tuning->ticks_sample_hf >= tuning->ticks_sample_lf && SAMPLE_WINDOW_VALID(tuning->ticks_sample_hf) &&
+        tuning->ticks_reset_lf > tuning->ticks_sample_lf + RTC_CC_SAMPLE_START_VALUE + 2 &&
+        tuning->ticks_reset_hf - RTC_TICKS_RESET_JITTER / 2 > tuning->ticks_sample_hf + RTC_CC_SAMPLE_START_VALUE + 2;
+#if CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+    windows = windows && PERIOD_CONVERSION_VALID(tuning->ticks_sample_hf);
+#endif
+    return margins && comp && windows ? 0 : -EINVAL;
+}
+
+/* the RTC is stopped between two windows while the update is applied, and restarted with a new period, such that no window runs with a mix of old and new */
+static void _tuning_swap_at_boundary(struct k_work *work) {
+    if (_state != _STATE_AUTONOMOUS_LOW_FREQUENCY && _state != _STATE_HIGH_FREQUENCY) return; // swapped by the next start
+
+    // RTC tasks take effect at the next LFCLK tick, so only stop with margin to the reset and the next window
+    const unsigned int key = irq_lock();
+    const uint32_t counter = RTC_SELECT->COUNTER;
+    const bool between_windows = counter >= RTC_SELECT->CC[RTC_CC_SAMPLE_END_IDX] && counter + 2 < RTC_SELECT->CC[RTC_CC_RESET_IDX];
+    if (between_windows) RTC_SELECT->TASKS_STOP = 1;
+    irq_unlock(key);
+    if (!between_windows) {
+        RTC_SELECT->INTENSET = RTC_INTENSET_COMPARE1_Msk; // delayed into the next period, retry after its window
+        return;
+    }
+
+    (void)_tuning_swap();
+    if (_state == _STATE_HIGH_FREQUENCY) {
+        RTC_SELECT->CC[RTC_CC_SAMPLE_END_IDX] = _tuning->ticks_sample_hf;
+        RTC_SELECT->CC[RTC_CC_RESET_IDX] = _tuning->ticks_reset_hf;
+#if CONFIG_CAP_TOUCH_HF_ADAPTIVE_WINDOW
+        _sample_window_ticks = _tuning->ticks_sample_hf;
+        _noise_prev.ticks = 0;
+        _noise_var = 0; // estimated for the previous full window
+#endif
+    } else {
+        RTC_SELECT->CC[RTC_CC_SAMPLE_END_IDX] = _tuning->ticks_sample_lf + RTC_CC_SAMPLE_START_VALUE;
+        RTC_SELECT->CC[RTC_CC_RESET_IDX] = _tuning->ticks_reset_lf;
+    }
+    RTC_SELECT->TASKS_CLEAR = 1;
+    RTC_SELECT->TASKS_START = 1;
+}
+
+/* only from the system work queue while no sample window runs, returns true if an update was swapped in */
+static bool _tuning_swap(void) {
+    if (atomic_get(&_tuning_update) != _TUNING_PENDING) return false;
+
+    const struct _tuning *prev = _tuning;
+    _tuning = prev == &_tuning_buf[0] ? &_tuning_buf[1] : &_tuning_buf[0];
+    RTC_SELECT->INTENCLR = RTC_INTENCLR_COMPARE1_Msk;
+
+    _comp_config = _tuning->comp;
+    _comp_config_apply();
+
+    // LF counts scale with the window length, so calibration starts over from the scaled calibration point
+    uint32_t nominal = _counter_region.nominal;
+    if (_tuning->ticks_sample_lf != prev->ticks_sample_lf) {
+        nominal = nominal * _tuning->ticks_sample_lf / prev->ticks_sample_lf;
+        _calibration_reset();
+        if (k_work_delayable_is_pending(&_calibration_capture_work)) {
+            k_work_reschedule(&_calibration_capture_work, K_SECONDS(_calibration_period));
+        }
+    }
+    _counter_region = ct_counter_region_calc(nominal, _tuning->activate_margin, _tuning->saturate_margin);
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+    // reference counts also scale with the window length, the next reference window continues the current scale
+    if (_tuning->ticks_sample_lf != prev->ticks_sample_lf) _reference_baseline[0] = 0;
+    if (_tuning->ticks_sample_hf != prev->ticks_sample_hf) _reference_baseline[1] = 0;
+#endif
+    _active_trigger_update();
+
+    atomic_set(&_tuning_update, _TUNING_IDLE); // the previous buffer is not read anymore
+    LOG_INF("tuning applied: margins %d/%d, iir %d, windows %d/%d, periods %d/%d", _tuning->activate_margin, _tuning->saturate_margin,
+        _tuning->iir_factor, _tuning->ticks_sample_lf, _tuning->ticks_sample_hf, _tuning->ticks_reset_lf, _tuning->ticks_reset_hf);
+    return true;
 }
+#endif
+
+#if CONFIG_CAP_TOUCH_AUTOTUNE_PERSIST || CONFIG_CAP_TOUCH_LIVE_TUNING_PERSIST
+static int _settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg) {
+#if CONFIG_CAP_TOUCH_AUTOTUNE_PERSIST
+    if (settings_name_steq(name, "comp", NULL)) return _settings_comp_set(len, read_cb, cb_arg);
+#endif
+#if CONFIG_CAP_TOUCH_LIVE_TUNING_PERSIST
+    if (settings_name_steq(name, "tuning", NULL)) {
+        struct cap_touch_tuning tuning;
+        if (len != sizeof(tuning)) return -EINVAL;
+        if (read_cb(cb_arg, &tuning, sizeof(tuning)) != sizeof(tuning)) return -EIO;
+
+        // loaded before start, swapped in by it. The stored COMP setting takes precedence over autotune
+        const int err = _tuning_write(&tuning);
+        if (err) return err;
+#if CONFIG_CAP_TOUCH_AUTOTUNE
+        _comp_tuned = true;
+#endif
+        LOG_INF("loaded tuning");
+        return 0;
+    }
+#endif
+    return -ENOENT;
+}
+SETTINGS_STATIC_HANDLER_DEFINE(cap_touch, "cap_touch", NULL, _settings_set, NULL, NULL);
+#endif
 
 static void _configure_counter(void) {
     COUNTER_SELECT->MODE = TIMER_MODE_MODE_LowPowerCounter << TIMER_MODE_MODE_Pos;
@@ -265,10 +1157,18 @@ static void _configure_counter(void) {
 static void _configure_rtc(void) {
     RTC_SELECT->EVTENSET = RTC_EVTEN_COMPARE0_Msk | RTC_EVTEN_COMPARE1_Msk | RTC_EVTEN_COMPARE2_Msk;
     RTC_SELECT->CC[RTC_CC_SAMPLE_START_IDX] = RTC_CC_SAMPLE_START_VALUE;
+#if CONFIG_CAP_TOUCH_LIVE_TUNING || CONFIG_CAP_TOUCH_DIFFERENTIAL || CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+    // sample end interrupt, only enabled while a tuning update, a LF reference window or a drift measurement is pending
+    IRQ_CONNECT(RTC_IRQn, 3, _rtc_irq, 0, 0);
+    irq_enable(RTC_IRQn);
+#endif
 }
 
 static void _configure_egu(void) {
     EGU_SELECT->INTENSET = EGU_INTENSET_TRIGGERED0_Msk;
+#if CONFIG_CAP_TOUCH_PROXIMITY
+    EGU_SELECT->INTENSET = EGU_INTENSET_TRIGGERED2_Msk;
+#endif
     IRQ_CONNECT(EGU_IRQn, 3, _egu_irq, 0, 0);
     irq_enable(EGU_IRQn);
 }
@@ -279,7 +1179,12 @@ static void _configure_ppi(void) {
     const uint32_t ppi_group_calibration_capture_hf = ppi_new_group_find();     // 3
 
     // connect COMP to Count timer
-    (void)ppi_connect(&NRF_COMP->EVENTS_CROSS, &COUNTER_SELECT->TASKS_COUNT);
+    const uint32_t ppi_comp_count = ppi_connect(&NRF_COMP->EVENTS_CROSS, &COUNTER_SELECT->TASKS_COUNT);
+#if CONFIG_CAP_TOUCH_PROXIMITY
+    ppi_fork(ppi_comp_count, &PROXIMITY_COUNTER_SELECT->TASKS_COUNT);
+#else
+    ARG_UNUSED(ppi_comp_count);
+#endif
 
     // Timer output CCs. IRQ intercept and calibration compare
     _ppi_isr_always_activate = ppi_connect(&COUNTER_SELECT->EVENTS_COMPARE[COUNTER_CC_ACTIVE_TRIGGER], &NRF_PPI->TASKS_CHG[ppi_group_sample_activate].DIS);
@@ -287,7 +1192,8 @@ static void _configure_ppi(void) {
     _ppi_calibration_hf_compare = ppi_connect(&COUNTER_SELECT->EVENTS_COMPARE[COUNTER_CC_CALIBRATION_CAPTURE_HF], &NRF_PPI->TASKS_CHG[ppi_group_calibration_capture_hf].EN);
 
     // RTC sampling start
-    (void)ppi_connect(&RTC_SELECT->EVENTS_COMPARE[RTC_CC_SAMPLE_START_IDX], &NRF_COMP->TASKS_START);
+    const uint32_t ppi_comp_start = ppi_connect(&RTC_SELECT->EVENTS_COMPARE[RTC_CC_SAMPLE_START_IDX], &NRF_COMP->TASKS_START);
+    ARG_UNUSED(ppi_comp_start);
     
     const uint32_t ppi_pwm_on1 = ppi_connect(&RTC_SELECT->EVENTS_COMPARE[RTC_CC_SAMPLE_START_IDX], &NRF_PPI->TASKS_CHG[ppi_group_sample_activate].EN);
     ppi_fork(ppi_pwm_on1, &COUNTER_SELECT->TASKS_CLEAR);
@@ -311,9 +1217,243 @@ static void _configure_ppi(void) {
     // RTC reset
     (void)ppi_connect(&RTC_SELECT->EVENTS_COMPARE[RTC_CC_RESET_IDX], &RTC_SELECT->TASKS_CLEAR);
 
+#if CONFIG_CAP_TOUCH_RADIO_COEXIST
+    // latch radio activity during the sample window
+    const uint32_t ppi_group_radio_active = ppi_new_group_find();
+    const uint32_t ppi_radio_ready = ppi_connect(&NRF_RADIO->EVENTS_READY, &EGU_SELECT->TASKS_TRIGGER[EGU_RADIO_ACTIVE_IDX]);
+    const uint32_t ppi_radio_disabled = ppi_connect(&NRF_RADIO->EVENTS_DISABLED, &EGU_SELECT->TASKS_TRIGGER[EGU_RADIO_ACTIVE_IDX]);
+    NRF_PPI->CHG[ppi_group_radio_active] = (1 << ppi_radio_ready) | (1 << ppi_radio_disabled);
+    NRF_PPI->CHENCLR = (1 << ppi_radio_ready) | (1 << ppi_radio_disabled);
+    ppi_fork(ppi_comp_start, &NRF_PPI->TASKS_CHG[ppi_group_radio_active].EN);
+    ppi_fork(ppi_pwm_off, &NRF_PPI->TASKS_CHG[ppi_group_radio_active].DIS);
+#endif
+
     // from measurements, starting and stopping the Timer makes no difference on power consumption
 }
 
+#if CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+static void _configure_period_timer(void) {
+    PERIOD_TIMER_SELECT->MODE = TIMER_MODE_MODE_Timer << TIMER_MODE_MODE_Pos;
+    PERIOD_TIMER_SELECT->BITMODE = TIMER_BITMODE_BITMODE_32Bit << TIMER_BITMODE_BITMODE_Pos;
+    PERIOD_TIMER_SELECT->PRESCALER = 0; // 16MHz
+
+    // time from sample start until N oscillations are counted. The timer is stopped at sample end in case N is never reached
+    _ppi_period_start = ppi_connect(&RTC_SELECT->EVENTS_COMPARE[RTC_CC_SAMPLE_START_IDX], &PERIOD_TIMER_SELECT->TASKS_CLEAR);
+    ppi_fork(_ppi_period_start, &PERIOD_TIMER_SELECT->TASKS_START);
+    _ppi_period_capture = ppi_connect(&COUNTER_SELECT->EVENTS_COMPARE[COUNTER_CC_PERIOD_END], &PERIOD_TIMER_SELECT->TASKS_CAPTURE[PERIOD_TIMER_CC_CAPTURE]);
+    ppi_fork(_ppi_period_capture, &PERIOD_TIMER_SELECT->TASKS_STOP);
+    _ppi_period_stop = ppi_connect(&RTC_SELECT->EVENTS_COMPARE[RTC_CC_SAMPLE_END_IDX], &PERIOD_TIMER_SELECT->TASKS_STOP);
+
+    _period_measure_enable(false);
+}
+
+static void _period_measure_enable(bool enable) {
+    const uint32_t channels = (1 << _ppi_period_start) | (1 << _ppi_period_capture) | (1 << _ppi_period_stop);
+    struct onoff_manager *hf = z_nrf_clock_control_get_onoff(CLOCK_CONTROL_NRF_SUBSYS_HF);
+    if (enable) {
+        COUNTER_SELECT->CC[COUNTER_CC_PERIOD_END] = PERIOD_OSCILLATIONS;
+        PERIOD_TIMER_SELECT->CC[PERIOD_TIMER_CC_CAPTURE] = 0;
+        NRF_PPI->CHENSET = channels;
+        if (atomic_cas(&_period_hfxo_requested, 0, 1)) {
+            sys_notify_init_callback(&_period_hfxo_client.notify, _period_hfxo_started);
+            int err = onoff_request(hf, &_period_hfxo_client);
+            if (err < 0) {
+                atomic_set(&_period_hfxo_requested, 0);
+                LOG_WRN("HFXO request failed: %d", err);
+            }
+        }
+    } else {
+        NRF_PPI->CHENCLR = channels;
+        PERIOD_TIMER_SELECT->TASKS_STOP = 1;
+        atomic_set(&_period_hfxo_running, 0);
+        if (atomic_cas(&_period_hfxo_requested, 1, 0)) (void)onoff_cancel_or_release(hf, &_period_hfxo_client);
+    }
+}
+
+/* from the clock control interrupt, once HFXO runs */
+static void _period_hfxo_started(struct onoff_manager *mgr, struct onoff_client *cli, uint32_t state, int res) {
+    if (res < 0) {
+        atomic_set(&_period_hfxo_requested, 0);
+        LOG_WRN("HFXO not started: %d", res);
+        return;
+    }
+    atomic_set(&_period_hfxo_running, 1);
+}
+
+/* convert time of N oscillations to the equivalent count of a full HF window. Falls back to the count if N was not reached, or the timer ran on HFINT */
+static uint16_t _period_sample_get(uint16_t count) {
+    const uint32_t period_ticks = PERIOD_TIMER_SELECT->CC[PERIOD_TIMER_CC_CAPTURE];
+    PERIOD_TIMER_SELECT->CC[PERIOD_TIMER_CC_CAPTURE] = 0;
+
+    if (period_ticks == 0 || !atomic_get(&_period_hfxo_running)) {
+        return MIN((uint32_t)count << _SAMPLE_FRAC_BITS, UINT16_MAX);
+    }
+    const uint32_t ticks_window = _tuning->ticks_sample_hf - RTC_CC_SAMPLE_START_VALUE;
+    const uint32_t sample = (uint32_t)((PERIOD_OSCILLATIONS * PERIOD_TICKS_SAMPLE_HF(ticks_window) << _SAMPLE_FRAC_BITS) / period_ticks);
+    return MIN(sample, UINT16_MAX);
+}
+#endif
+
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+static void _configure_drift_timer(void) {
+    DRIFT_TIMER_SELECT->MODE = TIMER_MODE_MODE_Timer << TIMER_MODE_MODE_Pos;
+    DRIFT_TIMER_SELECT->BITMODE = TIMER_BITMODE_BITMODE_32Bit << TIMER_BITMODE_BITMODE_Pos;
+    DRIFT_TIMER_SELECT->PRESCALER = 0; // 16MHz
+
+    // time one sample window. Only enabled for a single window at a time, to limit HFCLK usage
+    _ppi_drift_start = ppi_connect(&RTC_SELECT->EVENTS_COMPARE[RTC_CC_SAMPLE_START_IDX], &DRIFT_TIMER_SELECT->TASKS_CLEAR);
+    ppi_fork(_ppi_drift_start, &DRIFT_TIMER_SELECT->TASKS_START);
+    _ppi_drift_capture = ppi_connect(&RTC_SELECT->EVENTS_COMPARE[RTC_CC_SAMPLE_END_IDX], &DRIFT_TIMER_SELECT->TASKS_CAPTURE[DRIFT_TIMER_CC_CAPTURE]);
+    ppi_fork(_ppi_drift_capture, &DRIFT_TIMER_SELECT->TASKS_STOP);
+    NRF_PPI->CHENCLR = (1 << _ppi_drift_start) | (1 << _ppi_drift_capture);
+}
+
+/* HFINT is only accurate to a few percent, so the window is timed against HFXO. HFXO is requested DRIFT_HFXO_STARTUP_TICKS before the next window
+ * starts, and released by the RTC interrupt at its end, such that it runs for about one window instead of a whole RTC period */
+static void _drift_measure_start(struct k_work *work) {
+    static const uint32_t DRIFT_HFXO_STARTUP_TICKS = 50; // ~1.5 ms, HFXO start-up with margin for the work queue latency
+
+    // the RTC is cleared at the reset compare, and the window starts RTC_CC_SAMPLE_START_VALUE later
+    const uint32_t counter = RTC_SELECT->COUNTER;
+    const uint32_t reset = RTC_SELECT->CC[RTC_CC_RESET_IDX];
+    const uint32_t ticks_to_start = (reset > counter ? reset - counter : 0) + RTC_CC_SAMPLE_START_VALUE;
+    const uint32_t delay_ticks = ticks_to_start > DRIFT_HFXO_STARTUP_TICKS ? ticks_to_start - DRIFT_HFXO_STARTUP_TICKS : 0;
+    k_work_schedule(&_drift_hfxo_request_work, K_USEC((uint64_t)delay_ticks * 1000000 / 32768));
+}
+
+static void _drift_hfxo_request(struct k_work *work) {
+    sys_notify_init_callback(&_drift_hfxo_client.notify, _drift_hfxo_started);
+    atomic_set(&_drift_hfxo_requested, 1);
+    int err = onoff_request(z_nrf_clock_control_get_onoff(CLOCK_CONTROL_NRF_SUBSYS_HF), &_drift_hfxo_client);
+    if (err < 0) {
+        atomic_set(&_drift_hfxo_requested, 0);
+        LOG_WRN("HFXO request failed: %d", err);
+        k_work_schedule(&_drift_measure_start_work, K_SECONDS(CONFIG_CAP_TOUCH_LFRC_DRIFT_PERIOD_SEC));
+    }
+}
+
+/* from the clock control interrupt, once HFXO runs */
+static void _drift_hfxo_started(struct onoff_manager *mgr, struct onoff_client *cli, uint32_t state, int res) {
+    if (res < 0) {
+        atomic_set(&_drift_hfxo_requested, 0);
+        LOG_WRN("HFXO not started: %d", res);
+        k_work_schedule(&_drift_measure_start_work, K_SECONDS(CONFIG_CAP_TOUCH_LFRC_DRIFT_PERIOD_SEC));
+        return;
+    }
+    // cleared and stopped, such that a window which started before this captures 0
+    DRIFT_TIMER_SELECT->TASKS_STOP = 1;
+    DRIFT_TIMER_SELECT->TASKS_CLEAR = 1;
+    DRIFT_TIMER_SELECT->CC[DRIFT_TIMER_CC_CAPTURE] = 0;
+    NRF_PPI->CHENSET = (1 << _ppi_drift_start) | (1 << _ppi_drift_capture);
+    atomic_set(&_drift_window_armed, 1);
+    RTC_SELECT->INTENSET = RTC_INTENSET_COMPARE1_Msk;
+}
+
+/* also cancels a request which has not completed yet */
+static void _drift_hfxo_release(void) {
+    if (!atomic_cas(&_drift_hfxo_requested, 1, 0)) return;
+    (void)onoff_cancel_or_release(z_nrf_clock_control_get_onoff(CLOCK_CONTROL_NRF_SUBSYS_HF), &_drift_hfxo_client);
+}
+
+/* from the RTC interrupt at sample end, the capture is already done by PPI */
+static void _drift_window_end(void) {
+    if (DRIFT_TIMER_SELECT->CC[DRIFT_TIMER_CC_CAPTURE] == 0) {
+        RTC_SELECT->INTENSET = RTC_INTENSET_COMPARE1_Msk; // armed during this window, measure the next
+        return;
+    }
+    atomic_set(&_drift_window_armed, 0);
+    NRF_PPI->CHENCLR = (1 << _ppi_drift_start) | (1 << _ppi_drift_capture);
+    _drift_hfxo_release();
+    k_work_schedule(&_drift_measure_capture_work, K_NO_WAIT);
+}
+
+static void _drift_measure_capture(struct k_work *work) {
+    static const uint32_t DRIFT_MAX_PERCENT = 5; // larger deviations are assumed to be a window interrupted by a state transition
+
+    k_work_schedule(&_drift_measure_start_work, K_SECONDS(CONFIG_CAP_TOUCH_LFRC_DRIFT_PERIOD_SEC));
+
+    // the window length depends on the current state, 16MHz / 32768Hz = 15625 / 32
+#if CONFIG_CAP_TOUCH_HF_ADAPTIVE_WINDOW
+    if (_state == _STATE_HIGH_FREQUENCY) return; // the window length changes at every sample end, measured again in the next period
+#endif
+    const uint32_t window_real = DRIFT_TIMER_SELECT->CC[DRIFT_TIMER_CC_CAPTURE];
+    const uint32_t window_nominal = (RTC_SELECT->CC[RTC_CC_SAMPLE_END_IDX] - RTC_SELECT->CC[RTC_CC_SAMPLE_START_IDX]) * 15625 / 32;
+    RETURN_ON_WRN_MSG(window_real == 0, "no sample window captured");
+
+    const uint32_t deviation = window_real > window_nominal ? window_real - window_nominal : window_nominal - window_real;
+    RETURN_ON_WRN_MSG(deviation * 100 > window_nominal * DRIFT_MAX_PERCENT, "sample window out of range: %d, nominal %d", window_real, window_nominal);
+
+    _drift_scale = ((uint64_t)window_nominal << 16) / window_real;
+    LOG_DBG("sample window: %d, nominal %d", window_real, window_nominal);
+    _active_trigger_update();
+}
+
+/* scale a count from the real window length to the nominal window length */
+static uint32_t _drift_normalise(uint32_t count) {
+    return ((uint64_t)count * _drift_scale + (1 << 15)) >> 16;
+}
+
+/* scale a count from the nominal window length to the real window length, for levels compared by the hardware */
+static uint32_t _drift_denormalise(uint32_t count) {
+    return ((uint64_t)count << 16) / _drift_scale;
+}
+#endif
+
+#if CONFIG_CAP_TOUCH_PROXIMITY
+static void _configure_proximity(void) {
+    PROXIMITY_COUNTER_SELECT->MODE = TIMER_MODE_MODE_LowPowerCounter << TIMER_MODE_MODE_Pos;
+    PROXIMITY_COUNTER_SELECT->BITMODE = TIMER_BITMODE_BITMODE_32Bit << TIMER_BITMODE_BITMODE_Pos;
+    PROXIMITY_WINDOW_SELECT->MODE = TIMER_MODE_MODE_LowPowerCounter << TIMER_MODE_MODE_Pos;
+    PROXIMITY_WINDOW_SELECT->BITMODE = TIMER_BITMODE_BITMODE_32Bit << TIMER_BITMODE_BITMODE_Pos;
+    PROXIMITY_WINDOW_SELECT->CC[PROXIMITY_WINDOW_CC_END] = PROXIMITY_WINDOWS;
+    PROXIMITY_WINDOW_SELECT->SHORTS = TIMER_SHORTS_COMPARE0_CLEAR_Msk;
+
+    const uint32_t ppi_group_approach = ppi_new_group_find();
+    const uint32_t ppi_window_count = ppi_connect(&RTC_SELECT->EVENTS_COMPARE[RTC_CC_SAMPLE_END_IDX], &PROXIMITY_WINDOW_SELECT->TASKS_COUNT);
+
+    // end of integration. The approach channel is evaluated before the group is enabled again for the next integration
+    _ppi_approach = ppi_connect(&PROXIMITY_WINDOW_SELECT->EVENTS_COMPARE[PROXIMITY_WINDOW_CC_END], &EGU_SELECT->TASKS_TRIGGER[EGU_APPROACH_IDX]);
+    NRF_PPI->CHG[ppi_group_approach] = 1 << _ppi_approach;
+    const uint32_t ppi_approach_rearm = ppi_connect(&PROXIMITY_WINDOW_SELECT->EVENTS_COMPARE[PROXIMITY_WINDOW_CC_END], &NRF_PPI->TASKS_CHG[ppi_group_approach].EN);
+    ppi_fork(ppi_approach_rearm, &PROXIMITY_COUNTER_SELECT->TASKS_CLEAR);
+
+    // approach level reached, no approach in this integration
+    const uint32_t ppi_approach_reached = ppi_connect(&PROXIMITY_COUNTER_SELECT->EVENTS_COMPARE[PROXIMITY_COUNTER_CC_APPROACH], &NRF_PPI->TASKS_CHG[ppi_group_approach].DIS);
+
+    _ppi_proximity_mask = (1 << ppi_window_count) | (1 << ppi_approach_rearm) | (1 << ppi_approach_reached);
+    _proximity_enable(false);
+}
+
+/* the first integration after enabling is partial, the approach channel is enabled at its end */
+static void _proximity_enable(bool enable) {
+    if (enable) {
+        PROXIMITY_WINDOW_SELECT->TASKS_CLEAR = 1;
+        PROXIMITY_COUNTER_SELECT->TASKS_CLEAR = 1;
+        PROXIMITY_WINDOW_SELECT->TASKS_START = 1;
+        PROXIMITY_COUNTER_SELECT->TASKS_START = 1;
+        NRF_PPI->CHENSET = _ppi_proximity_mask;
+    } else {
+        NRF_PPI->CHENCLR = _ppi_proximity_mask | (1 << _ppi_approach);
+        PROXIMITY_WINDOW_SELECT->TASKS_STOP = 1;
+        PROXIMITY_COUNTER_SELECT->TASKS_STOP = 1;
+    }
+}
+
+static void _approach_notify(struct k_work *work) {
+    LOG_DBG("approach");
+    if (_approach_cb) _approach_cb();
+#if CONFIG_CAP_TOUCH_ZBUS
+    const struct cap_touch_msg msg = {
+        .timestamp_ms = k_uptime_get_32(),
+        .type = CAP_TOUCH_MSG_APPROACH,
+        .mode = CAP_TOUCH_MSG_MODE_LF,
+    };
+    int err = zbus_chan_pub(&cap_touch_chan_event, &msg, K_NO_WAIT);
+    LOG_WRN_IF(err, "approach publish failed: %d", err);
+#endif
+}
+#endif
+
 static void _calibration_start(struct k_work *work) {
     _calibration_reset();
     k_work_schedule(&_calibration_capture_work, K_SECONDS(_calibration_period));
@@ -334,20 +1474,36 @@ static void _calibration_capture(struct k_work *work) {
     static const size_t CALIBRATION_RANK = 3; // second biggest
     
     // capture calibration and reset. We use LF calibration point by default. But if it is not set (been in HF mode since last calibration), we include HF calibration point
-    volatile const uint32_t calibration_point_lf = COUNTER_SELECT->CC[COUNTER_CC_CALIBRATION_CAPTURE_LF];
-    volatile const uint32_t calibration_point_hf = COUNTER_SELECT->CC[COUNTER_CC_CALIBRATION_CAPTURE_HF];
-    const uint32_t calibration_point_hf_norm = calibration_point_hf * (RTC_TICKS_SAMPLE) / (RTC_TICKS_SAMPLE_HF);
+    if (!_chain_rtc_running()) {
+        _chain_recover("no RTC period since last calibration");
+        return;
+    }
+
+    volatile uint32_t calibration_point_lf = COUNTER_SELECT->CC[COUNTER_CC_CALIBRATION_CAPTURE_LF];
+    volatile uint32_t calibration_point_hf = COUNTER_SELECT->CC[COUNTER_CC_CALIBRATION_CAPTURE_HF];
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+    if (calibration_point_lf != CALIBRATION_VAL_RESET) calibration_point_lf = _drift_normalise(calibration_point_lf);
+    if (calibration_point_hf != CALIBRATION_VAL_RESET) calibration_point_hf = _drift_normalise(calibration_point_hf);
+#endif
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+    if (calibration_point_lf != CALIBRATION_VAL_RESET) calibration_point_lf = _reference_normalise(calibration_point_lf);
+    if (calibration_point_hf != CALIBRATION_VAL_RESET) calibration_point_hf = _reference_normalise(calibration_point_hf);
+#endif
+    const uint32_t calibration_point_hf_norm = calibration_point_hf * _tuning->ticks_sample_lf / _tuning->ticks_sample_hf;
 
     COUNTER_SELECT->CC[COUNTER_CC_CALIBRATION_CAPTURE_LF] = CALIBRATION_VAL_RESET;
     COUNTER_SELECT->CC[COUNTER_CC_CALIBRATION_CAPTURE_HF] = CALIBRATION_VAL_RESET;
+#if CONFIG_CAP_TOUCH_HF_ADAPTIVE_WINDOW
+    atomic_set(&_sample_window_full_pending, 1); // at least one capturing window in _STATE_HIGH_FREQUENCY before the next capture
+#endif
 
     LOG_DBG("calibration: %d, %d [%d]", calibration_point_lf, calibration_point_hf_norm, calibration_point_hf);
     const uint32_t calibration_consolidate = calibration_point_lf == CALIBRATION_VAL_RESET ? MAX(calibration_point_lf, calibration_point_hf_norm) : calibration_point_lf;
     if (calibration_consolidate <= CALIBRATION_VAL_RESET) {
-        LOG_ERR("no new calubration value");
-        k_work_schedule(&_calibration_capture_work, K_SECONDS(_calibration_period));
+        // every window counts well above CALIBRATION_VAL_RESET, so the oscillator or counter has stalled
+        _chain_recover("no new calibration value");
+        return;
     }
-    RETURN_ON_ERR_MSG(calibration_consolidate <= CALIBRATION_VAL_RESET, "no new calibration value");
 
     // store calibration point, will need at least 3 points to get a valid calibration
     _calibration_buf[_calibration_buf_idx] = calibration_consolidate;
@@ -372,92 +1528,463 @@ static void _calibration_capture(struct k_work *work) {
     k_work_schedule(&_calibration_capture_work, K_SECONDS(_calibration_period));
 }
 
+#if CONFIG_CAP_TOUCH_STUCK_TIMEOUT_SEC > 0
+static void _stuck_rebaseline(struct k_work *work) {
+    RETURN_ON_WRN_MSG(_state != _STATE_HIGH_FREQUENCY, "stuck check outside high frequency state");
+
+    // the filtered HF value, scaled to a LF calibration point
+    const uint32_t calibration_point = ((uint32_t)_sample_filtered * _tuning->ticks_sample_lf / _tuning->ticks_sample_hf) >> _SAMPLE_FRAC_BITS;
+    LOG_WRN("stuck touch for %d s, re-baselining from %d to %d", CONFIG_CAP_TOUCH_STUCK_TIMEOUT_SEC, _counter_region.nominal, calibration_point);
+#if CONFIG_CAP_TOUCH_RECORDER
+    ct_recorder_trigger(CT_RECORDER_TRIGGER_STUCK);
+#endif
+
+    // fill the calibration buffer, such that the median follows the new level until the pad is uncovered, with fast captures to recover
+    _calibration_reset();
+    for (int i = 0; i < ARRAY_SIZE(_calibration_buf); i++) {
+        _calibration_buf[i] = calibration_point;
+    }
+    _counter_region_set(calibration_point);
+    k_work_reschedule(&_calibration_capture_work, K_SECONDS(_calibration_period));
+
+#if CONFIG_CAP_TOUCH_ZBUS
+    const struct cap_touch_msg msg = {
+        .timestamp_ms = k_uptime_get_32(),
+        .type = CAP_TOUCH_MSG_STUCK,
+        .level = _output_prev,
+        .mode = CAP_TOUCH_MSG_MODE_HF,
+        .channels = BIT(0),
+    };
+    int err = zbus_chan_pub(&cap_touch_chan_event, &msg, K_NO_WAIT);
+    LOG_WRN_IF(err, "stuck publish failed: %d", err);
+    _msg_publish(0);
+#endif
+    if (_output_prev != 0) {
+        _output_prev = 0;
+        if (_cb) _cb(0);
+    }
+
+    _set_state(_STATE_AUTONOMOUS_LOW_FREQUENCY, (1 << _STATE_HIGH_FREQUENCY));
+}
+#endif
+
+/* the reset compare event is not cleared by the PPI chain, so it is set if at least one RTC period passed since the last call */
+static bool _chain_rtc_running(void) {
+    const bool running = RTC_SELECT->EVENTS_COMPARE[RTC_CC_RESET_IDX];
+    RTC_SELECT->EVENTS_COMPARE[RTC_CC_RESET_IDX] = 0;
+    return running;
+}
+
+/* restore the peripheral configuration and restart through _STATE_OFF, which also restarts calibration */
+static void _chain_recover(const char *reason) {
+    _chain_incidents++;
+    LOG_ERR("measurement chain stalled: %s, restarting (incident %d)", reason, _chain_incidents);
+#if CONFIG_CAP_TOUCH_RECORDER
+    ct_recorder_trigger(CT_RECORDER_TRIGGER_CHAIN);
+#endif
+
+    const enum _state state = _state;
+    _set_state(_STATE_OFF, (1 << _STATE_AUTONOMOUS_LOW_FREQUENCY) | (1 << _STATE_HIGH_FREQUENCY));
+    RETURN_ON_ERR_MSG(_state != _STATE_OFF, "could not stop from state %d", state);
+    _configure_comparator();
+    _configure_counter();
+    _configure_rtc();
+    _set_state(_STATE_AUTONOMOUS_LOW_FREQUENCY, (1 << _STATE_OFF));
+
+    if (_output_prev != 0) {
+        _output_prev = 0;
+        if (_cb) _cb(0);
+    }
+}
+
 static void _counter_region_set(uint32_t calibration_point) {
     if (calibration_point == _counter_region.nominal && _counter_region.activate >= 2) return; // second compare to check if uninitialized
 
-    static const uint8_t ACTIVATE_MARGIN = _FIXED8_PERCENT(80);
-    static const uint8_t SATURATE_MARGIN = _FIXED8_PERCENT(40);
+    _counter_region = ct_counter_region_calc(calibration_point, _tuning->activate_margin, _tuning->saturate_margin);
 
-    uint32_t activate = (calibration_point * ACTIVATE_MARGIN) >> 8;
-    uint32_t saturate = (calibration_point * SATURATE_MARGIN) >> 8;
+    LOG_INF("new regions: nominal: %d, activate: %d, saturate: %d", _counter_region.nominal, _counter_region.activate, _counter_region.saturate);
+    _active_trigger_update();
+}
+
+static void _active_trigger_update(void) {
+#if CONFIG_CAP_TOUCH_PROXIMITY
+    // never below the touch level, such that an uncalibrated region does not give approach events
+    uint32_t approach = MAX(_counter_region.nominal * PROXIMITY_WINDOWS * CONFIG_CAP_TOUCH_PROXIMITY_PERCENT / 100, (_counter_region.activate + 1) * PROXIMITY_WINDOWS);
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+    approach = _reference_denormalise(approach);
+#endif
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+    PROXIMITY_COUNTER_SELECT->CC[PROXIMITY_COUNTER_CC_APPROACH] = _drift_denormalise(approach);
+#else
+    PROXIMITY_COUNTER_SELECT->CC[PROXIMITY_COUNTER_CC_APPROACH] = approach;
+#endif
+#endif
+#if CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+    if (NRF_PPI->CHEN & (1 << _ppi_period_capture)) return; // CC used for period measurement, set when returning to _STATE_AUTONOMOUS_LOW_FREQUENCY
+#endif
+    uint32_t activate = _counter_region.activate;
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+    // the hardware compares raw counts, so scale the trigger level to the current reference
+    activate = _reference_denormalise(activate);
+#endif
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+    // and to the real window length
+    activate = _drift_denormalise(activate);
+#endif
+    COUNTER_SELECT->CC[COUNTER_CC_ACTIVE_TRIGGER] = MAX(activate, 2U);
+}
+
+#if CONFIG_CAP_TOUCH_LIVE_TUNING || CONFIG_CAP_TOUCH_DIFFERENTIAL || CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+/* sample end, only enabled while a tuning update, a LF reference window or a drift measurement is pending. The comparator is stopped until the next window */
+static void _rtc_irq(void) {
+    RTC_SELECT->EVENTS_COMPARE[RTC_CC_SAMPLE_END_IDX] = 0;
+    RTC_SELECT->INTENCLR = RTC_INTENCLR_COMPARE1_Msk;
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+    if (atomic_get(&_drift_window_armed)) _drift_window_end();
+#endif
+#if CONFIG_CAP_TOUCH_LIVE_TUNING
+    if (atomic_get(&_tuning_update) == _TUNING_PENDING) (void)k_work_submit(&_tuning_swap_work);
+#endif
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+    if (!_reference_lf_pending) return;
+    if (_state == _STATE_AUTONOMOUS_LOW_FREQUENCY && _reference_window == _REFERENCE_WINDOW_NONE && k_msgq_num_used_get(&_samples_msgq) == 0) {
+        _reference_lf_pending = false;
+        _reference_window_begin(_REFERENCE_WINDOW_LF);
+    } else if (_state == _STATE_AUTONOMOUS_LOW_FREQUENCY) {
+        RTC_SELECT->INTENSET = RTC_INTENSET_COMPARE1_Msk; // a wakeup is being processed, retry after the next window
+    } else {
+        _reference_lf_pending = false; // measured by the HF windows
+    }
+#endif
+}
+#endif
 
-    // minimum value which assures no conflict
-    if (activate < 2) {
-        activate = 3;
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+/* from the sample interrupts, between two windows. The next window measures the reference and triggers the EGU event regardless of its count */
+static void _reference_window_begin(enum _reference_window kind) {
+    NRF_COMP->PSEL = _psel_reference;
+    if (kind == _REFERENCE_WINDOW_LF) {
+        NRF_PPI->CHENCLR = (1 << _ppi_isr_always_activate) | (1 << _ppi_calibration_lf_compare) | _ppi_detect_mask;
+#if CONFIG_CAP_TOUCH_OUTPUT_PIN
+        NRF_PPI->CHENCLR = _ppi_output_active_mask;
+#endif
+#if CONFIG_CAP_TOUCH_PROXIMITY
+        // paused, the integration continues after the reference window
+        PROXIMITY_WINDOW_SELECT->TASKS_STOP = 1;
+        PROXIMITY_COUNTER_SELECT->TASKS_STOP = 1;
+#endif
+    } else {
+        NRF_PPI->CHENCLR = 1 << _ppi_calibration_hf_compare;
     }
-    if (saturate >= activate) {
-        saturate = activate - 1;
+    _reference_window = kind;
+}
+
+/* from the sample interrupt after a reference window, count is 0 if the sample is discarded */
+static void _reference_window_end(uint32_t count) {
+    static const uint32_t REFERENCE_DEVIATION_MAX_PERCENT = 25; // larger changes are assumed to be a fault of the reference electrode
+
+    const enum _reference_window kind = _reference_window;
+    NRF_COMP->PSEL = _psel_sense;
+    _reference_window = _REFERENCE_WINDOW_NONE;
+    if (kind == _REFERENCE_WINDOW_LF) {
+        NRF_PPI->CHENSET = (1 << _ppi_isr_always_activate) | (1 << _ppi_calibration_lf_compare) | _ppi_detect_mask;
+#if CONFIG_CAP_TOUCH_OUTPUT_PIN
+        NRF_PPI->CHENSET = _ppi_output_active_mask;
+#endif
+#if CONFIG_CAP_TOUCH_PROXIMITY
+        PROXIMITY_WINDOW_SELECT->TASKS_START = 1;
+        PROXIMITY_COUNTER_SELECT->TASKS_START = 1;
+#endif
+    } else {
+#if CONFIG_CAP_TOUCH_HF_ADAPTIVE_WINDOW
+        if (RTC_SELECT->CC[RTC_CC_SAMPLE_END_IDX] == _tuning->ticks_sample_hf) // see _sample_window_apply()
+#endif
+        NRF_PPI->CHENSET = 1 << _ppi_calibration_hf_compare;
     }
+    if (count == 0) return;
 
-    _counter_region = (struct _counter_region){
-        .nominal = calibration_point, 
-        .activate = activate, 
-        .saturate = saturate,
-    };
+    // the first reference window of a mode continues the current scale, such that LF and HF counts stay comparable
+    uint32_t *baseline = &_reference_baseline[kind == _REFERENCE_WINDOW_HF];
+    if (*baseline == 0) *baseline = ((uint64_t)count * _reference_scale + (1 << 15)) >> 16;
+    const uint64_t scale = ((uint64_t)*baseline << 16) / count;
+    const uint64_t deviation = scale > (1 << 16) ? scale - (1 << 16) : (1 << 16) - scale;
+    if (deviation * 100 > (1 << 16) * REFERENCE_DEVIATION_MAX_PERCENT) return;
 
-    LOG_INF("new regions: nominal: %d, activate: %d, saturate: %d", _counter_region.nominal, _counter_region.activate, _counter_region.saturate);
-    COUNTER_SELECT->CC[COUNTER_CC_ACTIVE_TRIGGER] = _counter_region.activate;
+    _reference_scale = scale;
+    if (kind == _REFERENCE_WINDOW_LF) (void)k_work_submit(&_reference_lf_update_work);
 }
 
+/* from the system work queue. Restores the sense electrode without the channels changed by _reference_window_begin(), which the caller sets */
+static void _reference_window_cancel(void) {
+    const unsigned int key = irq_lock();
+    NRF_COMP->PSEL = _psel_sense;
+    _reference_window = _REFERENCE_WINDOW_NONE;
+    _reference_lf_pending = false;
+    irq_unlock(key);
+}
+
+static void _reference_lf_request(struct k_work *work) {
+    _reference_lf_pending = true;
+    RTC_SELECT->INTENSET = RTC_INTENSET_COMPARE1_Msk;
+    k_work_schedule(&_reference_lf_request_work, K_MSEC(CONFIG_CAP_TOUCH_DIFFERENTIAL_LF_PERIOD_MS));
+}
+
+static void _reference_lf_update(struct k_work *work) {
+    LOG_DBG("reference scale: %d/65536", _reference_scale);
+    _active_trigger_update();
+}
+
+/* scale a sense count to the reference at start */
+static uint32_t _reference_normalise(uint32_t count) {
+    return ((uint64_t)count * _reference_scale + (1 << 15)) >> 16;
+}
+
+/* scale a count from the reference at start to the current reference, for levels compared by the hardware */
+static uint32_t _reference_denormalise(uint32_t count) {
+    return ((uint64_t)count << 16) / _reference_scale;
+}
+#endif
+
 static void _egu_irq(void) {
+#if CONFIG_CAP_TOUCH_PROXIMITY
+    if (EGU_SELECT->EVENTS_TRIGGERED[EGU_APPROACH_IDX]) {
+        EGU_SELECT->EVENTS_TRIGGERED[EGU_APPROACH_IDX] = 0;
+        (void)k_work_submit(&_approach_notify_work);
+    }
+#endif
     if (EGU_SELECT->EVENTS_TRIGGERED[EGU_ACTIVATE_IDX]) {
         EGU_SELECT->EVENTS_TRIGGERED[EGU_ACTIVATE_IDX] = 0;
         volatile uint16_t sample = COUNTER_SELECT->CC[COUNTER_CC_SAMPLE_CAPTURE];
-        int ret = k_msgq_put(&_samples_msgq, (void*)&sample, K_NO_WAIT);
+        const uint16_t ticks = RTC_SELECT->CC[RTC_CC_SAMPLE_END_IDX] - RTC_CC_SAMPLE_START_VALUE; // of the window which just ended
+        if (_state == _STATE_HIGH_FREQUENCY) {
+            _sample_jitter_apply();
+#if CONFIG_CAP_TOUCH_HF_ADAPTIVE_WINDOW
+            _sample_window_apply();
+            sample = MIN((uint32_t)sample * (_tuning->ticks_sample_hf - RTC_CC_SAMPLE_START_VALUE) / ticks, UINT16_MAX);
+#endif
+        }
+#if CONFIG_CAP_TOUCH_LFRC_DRIFT_COMPENSATE
+        sample = MIN(_drift_normalise(sample), UINT16_MAX);
+#endif
+#if CONFIG_CAP_TOUCH_HF_PERIOD_MEASURE
+        if (_state == _STATE_HIGH_FREQUENCY) {
+            sample = _period_sample_get(sample);
+        }
+#endif
+        const bool tainted = _sample_radio_tainted();
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+        if (_reference_window != _REFERENCE_WINDOW_NONE) {
+            _reference_window_end(tainted ? 0 : sample);
+            return; // not a sense sample
+        }
+        // only when the activate channel is disabled, such that no reference window is started after the return to _STATE_AUTONOMOUS_LOW_FREQUENCY began
+        static uint32_t sense_windows = 0;
+        if (_state == _STATE_HIGH_FREQUENCY && !(NRF_PPI->CHEN & (1 << _ppi_isr_always_activate)) && _psel_reference != UINT32_MAX &&
+            ++sense_windows >= CONFIG_CAP_TOUCH_DIFFERENTIAL_HF_INTERVAL) {
+            sense_windows = 0;
+            _reference_window_begin(_REFERENCE_WINDOW_HF);
+        }
+        sample = MIN(_reference_normalise(sample), UINT16_MAX);
+#endif
+        if (tainted) {
+            return; // discarded, the autonomous mode is re-armed at the next sample start
+        }
+        const struct _sample msg = {.value = sample, .ticks = ticks};
+        int ret = k_msgq_put(&_samples_msgq, &msg, K_NO_WAIT);
         LOG_WRN_IF(ret, "msgq full");
         (void)k_work_submit(&_sample_process_work);
     }
 }
 
+/* set the reset point of the current RTC period, called after sample end which is always before the earliest reset point */
+static void _sample_jitter_apply(void) {
+#if RTC_TICKS_RESET_JITTER > 0
+    // _state is only updated at the end of _set_state(), the activate channel is enabled before the LF reset point is written
+    if (NRF_PPI->CHEN & (1 << _ppi_isr_always_activate)) return; // returning to _STATE_AUTONOMOUS_LOW_FREQUENCY
+    static uint32_t lfsr = 0xACE1u;
+    lfsr ^= lfsr << 13; // xorshift32
+    lfsr ^= lfsr >> 17;
+    lfsr ^= lfsr << 5;
+    RTC_SELECT->CC[RTC_CC_RESET_IDX] = _tuning->ticks_reset_hf - RTC_TICKS_RESET_JITTER / 2 + lfsr % RTC_TICKS_RESET_JITTER;
+#endif
+}
+
+#if CONFIG_CAP_TOUCH_HF_ADAPTIVE_WINDOW
+/* set the sample end of the next window, called after sample end. The calibration capture keeps the highest raw count, which is only comparable between full windows */
+static void _sample_window_apply(void) {
+    if (NRF_PPI->CHEN & (1 << _ppi_isr_always_activate)) return; // returning to _STATE_AUTONOMOUS_LOW_FREQUENCY
+    const uint16_t ticks = atomic_cas(&_sample_window_full_pending, 1, 0) ? _tuning->ticks_sample_hf : _sample_window_ticks;
+    RTC_SELECT->CC[RTC_CC_SAMPLE_END_IDX] = ticks;
+    if (ticks == _tuning->ticks_sample_hf) {
+        NRF_PPI->CHENSET = 1 << _ppi_calibration_hf_compare;
+    } else {
+        NRF_PPI->CHENCLR = 1 << _ppi_calibration_hf_compare;
+    }
+}
+
+/* noise variance of a full window sample, from the difference of two samples normalised to the full window n. The count variance is proportional to
+ * the window length w, so the normalised variance is var * n / w, and var(b - a) = var * (n / w_a + n / w_b) */
+static void _sample_noise_update(struct _sample sample) {
+    static const uint32_t NOISE_AVERAGE_LOG2 = 4;
+    static const uint64_t NOISE_OUTLIER = 16; // 4 standard deviations, such that touch edges do not dominate the estimate
+
+    const struct _sample prev = _noise_prev;
+    _noise_prev = sample;
+    if (prev.ticks == 0 || sample.ticks == 0) return;
+
+    const uint32_t n = _tuning->ticks_sample_hf - RTC_CC_SAMPLE_START_VALUE;
+    const int64_t diff = (int32_t)sample.value - (int32_t)prev.value;
+    uint64_t var = ((uint64_t)(diff * diff) << _NOISE_FRAC_BITS) * prev.ticks * sample.ticks / ((uint64_t)n * (prev.ticks + sample.ticks));
+    if (_noise_var == 0) {
+        _noise_var = MAX(MIN(var, UINT32_MAX), 1);
+        return;
+    }
+    var = MIN(var, _noise_var * NOISE_OUTLIER);
+    const int64_t update = ((int64_t)var - (int64_t)_noise_var) / (1 << NOISE_AVERAGE_LOG2);
+    _noise_var = MAX(MIN((int64_t)_noise_var + update, UINT32_MAX), 1);
+}
+
+/* the window at which the filtered value is CONFIG_CAP_TOUCH_HF_ADAPTIVE_SNR standard deviations from the activate level: distance^2 = SNR^2 * var * n / w */
+static uint16_t _sample_window_calc(uint16_t filtered) {
+    const uint32_t n = _tuning->ticks_sample_hf - RTC_CC_SAMPLE_START_VALUE;
+    const uint32_t activate = _counter_region.activate * _tuning->ticks_sample_hf / _tuning->ticks_sample_lf << _SAMPLE_FRAC_BITS; // as in ct_transform()
+    const uint32_t distance = filtered > activate ? filtered - activate : activate - filtered;
+    if (_noise_var == 0 || distance == 0) return _tuning->ticks_sample_hf;
+
+    const uint64_t snr2 = CONFIG_CAP_TOUCH_HF_ADAPTIVE_SNR * CONFIG_CAP_TOUCH_HF_ADAPTIVE_SNR;
+    const uint64_t w = (snr2 * n * _noise_var) / ((uint64_t)distance * distance << _NOISE_FRAC_BITS);
+    return CLAMP(w, MIN(CONFIG_CAP_TOUCH_HF_ADAPTIVE_TICKS_MIN, n), n) + RTC_CC_SAMPLE_START_VALUE;
+}
+#endif
+
+/* a radio event in the window, or the radio being active at the end of it, means the sample is tainted by supply noise */
+static bool _sample_radio_tainted(void) {
+#if CONFIG_CAP_TOUCH_RADIO_COEXIST
+    const bool tainted = EGU_SELECT->EVENTS_TRIGGERED[EGU_RADIO_ACTIVE_IDX] || (NRF_RADIO->STATE != RADIO_STATE_STATE_Disabled);
+    EGU_SELECT->EVENTS_TRIGGERED[EGU_RADIO_ACTIVE_IDX] = 0;
+    return tainted;
+#else
+    return false;
+#endif
+}
+
 static void _sample_process(struct k_work *work) {
-    static uint16_t value_filtered = 0;
+    static struct ct_filter filter;
+    if (_state == _STATE_SUSPENDED) return; // submitted before the suspend, the samples are purged
+#if CONFIG_CAP_TOUCH_AUTOTUNE
+    if (_state == _STATE_AUTOTUNE) {
+        _autotune_process();
+        return;
+    }
+#endif
 
-    uint16_t sample;
-    while (k_msgq_get(&_samples_msgq, &sample, K_NO_WAIT) == 0) {
+    struct _sample msg;
+    uint16_t sample = 0;
+    while (k_msgq_get(&_samples_msgq, &msg, K_NO_WAIT) == 0) {
+        sample = msg.value;
         if (sample == 0) {
             LOG_WRN("received 0 sample");
             continue;
         }
 
         if (_state == _STATE_AUTONOMOUS_LOW_FREQUENCY) {
+#if CONFIG_CAP_TOUCH_RECORDER
+            ct_recorder_push(sample, 0, 0, CT_RECORD_MODE_LOW_FREQUENCY); // the wakeup sample
+#endif
             _set_state(_STATE_HIGH_FREQUENCY, (1 << _STATE_AUTONOMOUS_LOW_FREQUENCY));
             k_msgq_purge(&_samples_msgq); // discard all samples, because they are scaled differently in the two modes
             return;
         }
+#if CONFIG_CAP_TOUCH_HF_ADAPTIVE_WINDOW
+        _sample_noise_update(msg);
+#endif
 
-        /* filter value, 1. order low pass */
-        static const uint8_t scale_factor = _FIXED8_PERCENT(40);
-        value_filtered = (value_filtered*scale_factor + sample*(UINT8_MAX - scale_factor) + 128) >> 8;
-
+        /* filter chain configured at compile time, see ct_filter.h */
+#ifdef CT_FILTER_IIR_FACTOR_RUNTIME
+        filter.iir_factor = _tuning->iir_factor;
+#endif
+        if (_filter_seed_pending) {
+            _filter_seed_pending = false;
+            ct_filter_seed(&filter, sample);
+        }
+        (void)ct_filter_process(&filter, sample);
     }
+    const uint16_t value_filtered = filter.value;
+    _sample_filtered = value_filtered;
 
     /* map value to something approximately proportional with capacitance, and range 0 to 127 */
-    // TODO: precalculate constants
-    static const int32_t a = _FIXED8_PERCENT(50);
-    const int32_t A = _counter_region.nominal * RTC_TICKS_SAMPLE_HF * a / RTC_TICKS_SAMPLE >> 8;
-    const int32_t Sp = _counter_region.activate * RTC_TICKS_SAMPLE_HF / RTC_TICKS_SAMPLE;
-    const int32_t Sn = _counter_region.saturate * RTC_TICKS_SAMPLE_HF / RTC_TICKS_SAMPLE;
-    const int32_t sample_clamp = CLAMP(value_filtered, (uint16_t)Sn, (uint16_t)Sp);
-
-    const int32_t denominator = (Sp - Sn)*(sample_clamp + A - Sn);
-    if (denominator == 0) {
+    const int32_t transformed = ct_transform(value_filtered, &_counter_region, _tuning->ticks_sample_lf, _tuning->ticks_sample_hf, _SAMPLE_FRAC_BITS);
+    if (transformed < 0) {
         LOG_WRN("denominator 0");
         return;
     }
-    const uint16_t value_transformed = 127*A*(Sp - sample_clamp)/denominator;
+    const uint16_t value_transformed = transformed;
+#if CONFIG_CAP_TOUCH_HF_ADAPTIVE_WINDOW
+    _sample_window_ticks = _sample_window_calc(value_filtered);
+#endif
 
 #if CONFIG_DEBUG
     uint16_t data[] = {sample, value_filtered, value_transformed};
     bt_log_notify((uint8_t*)data, sizeof(data));
 #endif
+#if CONFIG_CAP_TOUCH_RECORDER
+    ct_recorder_push(sample, value_filtered, value_transformed, CT_RECORD_MODE_HIGH_FREQUENCY);
+    if (value_transformed == 0 && _output_prev == 0 && _state == _STATE_HIGH_FREQUENCY) {
+        ct_recorder_trigger(CT_RECORDER_TRIGGER_FALSE_WAKE); // returning without any output since the wakeup
+    }
+#endif
 
     // keep in high power mode by uncommenting the rest of this
     if (value_transformed == 0)
         _set_state(_STATE_AUTONOMOUS_LOW_FREQUENCY, (1 << _STATE_HIGH_FREQUENCY));
 
-    static uint8_t output_prev = 0;
-    if (output_prev == value_transformed) return;
-    output_prev = value_transformed;
+#if CONFIG_CAP_TOUCH_ZBUS
+    _msg_publish(value_transformed);
+#endif
+
+    if (_output_prev == value_transformed) return;
+    _output_prev = value_transformed;
     LOG_DBG("out (comp): %d", value_transformed);
-    _cb(value_transformed);
+    if (_cb) _cb(value_transformed);
+}
+
+#if CONFIG_CAP_TOUCH_ZBUS
+/* called for every processed sample, such that hold is detected without level changes. Observers of one channel are not woken by the other */
+static void _msg_publish(uint8_t level) {
+    static uint8_t level_prev = 0;
+    static uint32_t down_ms;
+    static bool hold_published;
+
+    struct cap_touch_msg msg = {
+        .timestamp_ms = k_uptime_get_32(),
+        .level = level,
+        .mode = _state == _STATE_HIGH_FREQUENCY ? CAP_TOUCH_MSG_MODE_HF : CAP_TOUCH_MSG_MODE_LF,
+        .channels = level > 0 ? BIT(0) : 0, // single electrode
+    };
+
+    bool event = true;
+    if (level > 0 && level_prev == 0) {
+        msg.type = CAP_TOUCH_MSG_DOWN;
+        down_ms = msg.timestamp_ms;
+        hold_published = false;
+    } else if (level == 0 && level_prev > 0) {
+        msg.type = CAP_TOUCH_MSG_UP;
+    } else if (level > 0 && !hold_published && msg.timestamp_ms - down_ms >= CONFIG_CAP_TOUCH_HOLD_MS) {
+        msg.type = CAP_TOUCH_MSG_HOLD;
+        hold_published = true;
+    } else {
+        event = false;
+    }
+    if (event) {
+        int err = zbus_chan_pub(&cap_touch_chan_event, &msg, K_NO_WAIT);
+        LOG_WRN_IF(err, "event publish failed: %d", err);
+    }
+
+    if (level != level_prev) {
+        msg.type = CAP_TOUCH_MSG_LEVEL;
+        int err = zbus_chan_pub(&cap_touch_chan_level, &msg, K_NO_WAIT);
+        LOG_WRN_IF(err, "level publish failed: %d", err);
+    }
+    level_prev = level;
 }
+#endif
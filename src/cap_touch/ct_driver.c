@@ -0,0 +1,132 @@
+/*
+ * File: ct_driver.c
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Zephyr input device for the cap touch devicetree node
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/** Zephyr device of the bentdal,cap-touch-comp devicetree node, see dts/bindings/input/bentdal,cap-touch-comp.yaml. The node configuration is
+ * expanded per instance at compile time, and ct_current_oscillate.c selects its TIMER, RTC and EGU from the same node.
+ * 
+ * The level is reported as INPUT_ABS_Z on every change, and the zephyr,code key when it goes above or back to 0, synced by the last of them.
+ * 
+ * The device is initialised suspended, and cap touch runs while it has a runtime PM reference. The state machine of ct_current_oscillate.c runs
+ * on the system work queue, so references should be put with pm_device_runtime_put_async(), which suspends from the same queue.
+*/
+
+#define DT_DRV_COMPAT bentdal_cap_touch_comp
+
+#include "cap_touch.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/dt-bindings/gpio/gpio.h>
+#include <zephyr/input/input.h>
+#include <zephyr/pm/device.h>
+#include <zephyr/pm/device_runtime.h>
+
+#include "utils/macros_common.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(ct_driver, LOG_LEVEL_INF);
+
+// the module has a single state machine on fixed PPI channels
+BUILD_ASSERT(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT) == 1, "exactly one cap touch instance is supported");
+
+struct ct_driver_config {
+    uint32_t psel;
+    uint32_t psel_reference;    // UINT32_MAX if not set
+    uint32_t output_pin;        // UINT32_MAX if not set
+    int output_polarity;
+    uint16_t code;
+};
+
+struct ct_driver_data {
+    bool touched;
+};
+
+static void _event(uint8_t value);
+
+static int _init(const struct device *dev) {
+    const struct ct_driver_config *config = dev->config;
+
+    cap_touch_init(_event, config->psel, -1); // no pin is used by the current source oscillator
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL
+    if (config->psel_reference != UINT32_MAX) cap_touch_reference_init(config->psel_reference);
+#endif
+#if CONFIG_CAP_TOUCH_OUTPUT_PIN
+    if (config->output_pin != UINT32_MAX) cap_touch_output_init(config->output_pin, config->output_polarity);
+#endif
+
+    // stopped until the first runtime PM reference
+    pm_device_init_suspended(dev);
+    return pm_device_runtime_enable(dev);
+}
+
+static int _pm_action(const struct device *dev, enum pm_device_action action) {
+    switch (action) {
+        case PM_DEVICE_ACTION_RESUME:
+            cap_touch_resume(); // starts at the first resume
+            return 0;
+        case PM_DEVICE_ACTION_SUSPEND:
+            cap_touch_suspend(); // calibration is kept until the next resume
+            return 0;
+        default:
+            return -ENOTSUP;
+    }
+}
+
+/* from the system work queue */
+static void _event(uint8_t value) {
+    const struct device *dev = DEVICE_DT_INST_GET(0);
+    const struct ct_driver_config *config = dev->config;
+    struct ct_driver_data *data = dev->data;
+
+    const bool touched = value > 0;
+    const bool key = touched != data->touched;
+    data->touched = touched;
+
+    int err = input_report_abs(dev, INPUT_ABS_Z, value, !key, K_NO_WAIT);
+    if (!err && key) err = input_report_key(dev, config->code, touched, true, K_NO_WAIT);
+    LOG_WRN_IF(err, "input report failed: %d", err);
+}
+
+#define _OUTPUT_PIN(inst) COND_CODE_1(DT_INST_NODE_HAS_PROP(inst, output_gpios), (DT_INST_GPIO_PIN(inst, output_gpios)), (UINT32_MAX))
+#define _OUTPUT_POLARITY(inst) COND_CODE_1(DT_INST_NODE_HAS_PROP(inst, output_gpios), \
+    (!(DT_INST_GPIO_FLAGS(inst, output_gpios) & GPIO_ACTIVE_LOW)), (1))
+
+#define CT_DRIVER_DEFINE(inst) \
+    static const struct ct_driver_config _config_##inst = { \
+        .psel = DT_INST_PROP(inst, psel), \
+        .psel_reference = DT_INST_PROP_OR(inst, reference_psel, UINT32_MAX), \
+        .output_pin = _OUTPUT_PIN(inst), \
+        .output_polarity = _OUTPUT_POLARITY(inst), \
+        .code = DT_INST_PROP(inst, zephyr_code), \
+    }; \
+    static struct ct_driver_data _data_##inst; \
+    PM_DEVICE_DT_INST_DEFINE(inst, _pm_action); \
+    DEVICE_DT_INST_DEFINE(inst, _init, PM_DEVICE_DT_INST_GET(inst), &_data_##inst, &_config_##inst, \
+        POST_KERNEL, CONFIG_INPUT_INIT_PRIORITY, NULL);
+
+DT_INST_FOREACH_STATUS_OKAY(CT_DRIVER_DEFINE)
@@ -0,0 +1,80 @@
+/*
+ * File: ct_electrode_model.h
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Model of the COMP ISOURCE relaxation oscillator on a cap touch electrode
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Gives the number of COMP CROSS events in a sample window, as counted by the PPI chain in ct_current_oscillate.c, for a given electrode capacitance.
+ * Each crossing is one charge (or discharge) of the electrode between the COMP thresholds by ISOURCE, thus
+ * 
+ *     count = window * I / (C * (V_up - V_down)),    V = (TH + 1) / 64 * VDD
+ * 
+ * Which gives ~1600 counts for the 500 tick HF window with 2.5uA, TH 5/30 at 3V0 and ~20pF, in line with the recorded logs.
+ * A uniform noise term is added from a xorshift32 sequence, such that runs are reproducible.
+ * 
+ * The model only depends on the C standard library, such that it can drive the sample processing on host.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define CT_ELECTRODE_MODEL_LFCLK_HZ 32768
+
+struct ct_electrode_model {
+    uint32_t capacitance_ff;    // electrode and parasitic capacitance, without touch
+    uint16_t vdd_mv;
+    uint8_t th_up;              // COMP TH register values, 0 to 63
+    uint8_t th_down;
+    uint32_t isource_na;
+    uint32_t noise_counts;      // peak noise added to each window count
+    uint32_t rng;               // xorshift32 state, must be non zero
+};
+
+#define CT_ELECTRODE_MODEL_DEFAULT { \
+    .capacitance_ff = 20000, \
+    .vdd_mv = 3000, \
+    .th_up = 30, \
+    .th_down = 5, \
+    .isource_na = 2500, \
+    .noise_counts = 2, \
+    .rng = 0xACE1u, \
+}
+
+/* number of crossings in a window of window_ticks LFCLK ticks, with touch_ff added to the electrode capacitance */
+static inline uint32_t ct_electrode_model_count(struct ct_electrode_model *m, uint32_t window_ticks, uint32_t touch_ff) {
+    const uint32_t dv_mv = (uint32_t)(m->th_up - m->th_down) * m->vdd_mv / 64;
+    const uint64_t denominator = (uint64_t)CT_ELECTRODE_MODEL_LFCLK_HZ * (m->capacitance_ff + touch_ff) * dv_mv;
+    if (denominator == 0) return 0;
+    int64_t count = ((uint64_t)window_ticks * m->isource_na * 1000000000ull + denominator / 2) / denominator;
+
+    if (m->noise_counts) {
+        m->rng ^= m->rng << 13;
+        m->rng ^= m->rng >> 17;
+        m->rng ^= m->rng << 5;
+        count += (int64_t)(m->rng % (2 * m->noise_counts + 1)) - m->noise_counts;
+    }
+    return count > 0 ? (uint32_t)count : 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * File: ct_filter.h
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Compile time configurable fixed point filter chain for cap touch samples
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/** Stages are run in the order below, each is removed at compile time when disabled. Cycle costs are estimates for Cortex-M4 at -Os, per input sample.
+ * - median (CT_FILTER_MEDIAN_SIZE 3 or 5): spike rejection, delay of (size-1)/2 samples. ~60 cycles for 3, ~150 cycles for 5
+ * - decimation (CT_FILTER_DECIMATE_LOG2 > 0): first order CIC (boxcar sum) over 2^n samples, outputs every 2^n samples. ~10 cycles
+ * - IIR (CT_FILTER_IIR_FACTOR > 0): first order low pass, factor in 1/256 of the previous value. ~10 cycles
+ * - slew limit (CT_FILTER_SLEW_MAX > 0): limits change per output. ~8 cycles
+ * 
+ * With CT_FILTER_IIR_FACTOR_RUNTIME defined, the IIR factor is taken from struct ct_filter instead, such that it can be changed without a rebuild.
+ * 
+ * The header only depends on the C standard library, such that it can be benchmarked on host, see analysis/filter_bench.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utils/sorted_index_get.h"
+
+#ifndef CT_FILTER_MEDIAN_SIZE
+#define CT_FILTER_MEDIAN_SIZE CONFIG_CAP_TOUCH_FILTER_MEDIAN_SIZE
+#endif
+#ifndef CT_FILTER_DECIMATE_LOG2
+#define CT_FILTER_DECIMATE_LOG2 CONFIG_CAP_TOUCH_FILTER_DECIMATE_LOG2
+#endif
+#ifndef CT_FILTER_IIR_FACTOR
+#define CT_FILTER_IIR_FACTOR (CONFIG_CAP_TOUCH_FILTER_IIR_PERCENT * 255 / 100)
+#endif
+#ifndef CT_FILTER_SLEW_MAX
+#define CT_FILTER_SLEW_MAX CONFIG_CAP_TOUCH_FILTER_SLEW_MAX
+#endif
+
+#if CT_FILTER_MEDIAN_SIZE != 0 && CT_FILTER_MEDIAN_SIZE != 3 && CT_FILTER_MEDIAN_SIZE != 5
+#error "CT_FILTER_MEDIAN_SIZE must be 0, 3 or 5"
+#endif
+
+struct ct_filter {
+#if CT_FILTER_MEDIAN_SIZE
+    uint16_t median_buf[CT_FILTER_MEDIAN_SIZE];
+    uint8_t median_idx;
+    uint8_t median_fill;
+#endif
+#if CT_FILTER_DECIMATE_LOG2
+    uint32_t decimate_sum;
+    uint8_t decimate_count;
+#endif
+#ifdef CT_FILTER_IIR_FACTOR_RUNTIME
+    uint8_t iir_factor;
+#endif
+    uint16_t value;
+};
+
+/* restarts all stages from sample, as if it was the input since long. Samples from before are not comparable, e.g. from the previous HF period */
+static inline void ct_filter_seed(struct ct_filter *f, uint16_t sample) {
+#if CT_FILTER_MEDIAN_SIZE
+    for (uint8_t i = 0; i < CT_FILTER_MEDIAN_SIZE; i++) f->median_buf[i] = sample;
+    f->median_idx = 0;
+    f->median_fill = CT_FILTER_MEDIAN_SIZE;
+#endif
+#if CT_FILTER_DECIMATE_LOG2
+    f->decimate_sum = 0;
+    f->decimate_count = 0;
+#endif
+    f->value = sample;
+}
+
+/* returns true when a new output value is available in f->value */
+static inline bool ct_filter_process(struct ct_filter *f, uint16_t sample) {
+#if CT_FILTER_MEDIAN_SIZE
+    f->median_buf[f->median_idx] = sample;
+    f->median_idx = (f->median_idx + 1) % CT_FILTER_MEDIAN_SIZE;
+    if (f->median_fill < CT_FILTER_MEDIAN_SIZE) {
+        f->median_fill++;
+        if (f->median_fill < CT_FILTER_MEDIAN_SIZE) return false; // wait until buffer is filled
+    }
+    sample = sorted_index_get(f->median_buf, CT_FILTER_MEDIAN_SIZE, CT_FILTER_MEDIAN_SIZE / 2);
+#endif
+
+#if CT_FILTER_DECIMATE_LOG2
+    f->decimate_sum += sample;
+    if (++f->decimate_count < (1 << CT_FILTER_DECIMATE_LOG2)) return false;
+    sample = (f->decimate_sum + (1 << (CT_FILTER_DECIMATE_LOG2 - 1))) >> CT_FILTER_DECIMATE_LOG2;
+    f->decimate_sum = 0;
+    f->decimate_count = 0;
+#endif
+
+    uint16_t value = sample;
+#ifdef CT_FILTER_IIR_FACTOR_RUNTIME
+    value = (f->value * (uint32_t)f->iir_factor + sample * (uint32_t)(UINT8_MAX - f->iir_factor) + 128) >> 8;
+#elif CT_FILTER_IIR_FACTOR
+    value = (f->value * (uint32_t)CT_FILTER_IIR_FACTOR + sample * (uint32_t)(UINT8_MAX - CT_FILTER_IIR_FACTOR) + 128) >> 8;
+#endif
+
+#if CT_FILTER_SLEW_MAX
+    if (f->value == 0) {
+        // first output, nothing to limit against
+    } else if (value > f->value + CT_FILTER_SLEW_MAX) {
+        value = f->value + CT_FILTER_SLEW_MAX;
+    } else if (value + CT_FILTER_SLEW_MAX < f->value) {
+        value = f->value - CT_FILTER_SLEW_MAX;
+    }
+#endif
+
+    f->value = value;
+    return true;
+}
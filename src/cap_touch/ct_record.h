@@ -0,0 +1,107 @@
+/*
+ * File: ct_record.h
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Binary columnar recording format for cap touch samples
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Little endian, 4 byte aligned, such that a file can be memory mapped and the columns used in place. A file is a header followed by chunks:
+ * 
+ *     struct ct_record_header
+ *     chunk: struct ct_record_chunk_header, then columns of `rows` values each, in this order:
+ *         uint32_t timestamp_ms[rows]
+ *         uint16_t count[channels][rows]          raw oscillation count
+ *         uint16_t filtered[channels][rows]
+ *         uint8_t transformed[channels][rows]     0 to 127
+ *         uint8_t mode[rows]                      enum ct_record_mode
+ *         padding to 4 bytes
+ * 
+ * A chunk never spans two segments (one continuous recording, e.g. one finger distance), and holds at most CT_RECORD_CHUNK_ROWS_MAX rows,
+ * such that recordings can be written as a stream, also from the device. Columns not recorded are zero and cleared in ct_record_header::columns.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define CT_RECORD_MAGIC 0x31525443u        // "CTR1"
+#define CT_RECORD_CHUNK_MAGIC 0x4b4e4843u  // "CHNK"
+#define CT_RECORD_VERSION 1
+#define CT_RECORD_CHUNK_ROWS_MAX 1024
+#define CT_RECORD_DESCRIPTION_SIZE 32
+
+enum ct_record_column {
+    CT_RECORD_COLUMN_TIMESTAMP = 1 << 0,
+    CT_RECORD_COLUMN_COUNT = 1 << 1,
+    CT_RECORD_COLUMN_FILTERED = 1 << 2,
+    CT_RECORD_COLUMN_TRANSFORMED = 1 << 3,
+    CT_RECORD_COLUMN_MODE = 1 << 4,
+};
+
+enum ct_record_mode {
+    CT_RECORD_MODE_LOW_FREQUENCY = 0,
+    CT_RECORD_MODE_HIGH_FREQUENCY = 1,
+};
+
+enum ct_record_flag {
+    CT_RECORD_FLAG_LABEL_DISTANCE = 1 << 0, // chunk label is the finger distance in mm, <= 0 is touch
+};
+
+struct ct_record_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;           // sizeof(struct ct_record_header), chunks start here
+    uint8_t channels;
+    uint8_t columns;                // enum ct_record_column
+    uint8_t flags;                  // enum ct_record_flag
+    uint8_t reserved;
+    uint32_t sample_period_us;      // nominal
+    uint16_t window_ticks_lf;       // RTC_TICKS_SAMPLE
+    uint16_t window_ticks_hf;       // RTC_TICKS_SAMPLE_HF
+    char description[CT_RECORD_DESCRIPTION_SIZE];
+};
+
+struct ct_record_chunk_header {
+    uint32_t magic;
+    uint16_t rows;
+    uint16_t segment;
+    int16_t label;
+    uint16_t reserved;
+};
+
+_Static_assert(sizeof(struct ct_record_header) == 52, "ct_record_header layout");
+_Static_assert(sizeof(struct ct_record_chunk_header) == 12, "ct_record_chunk_header layout");
+
+#define CT_RECORD_ALIGN4(size) (((size) + 3) & ~3u)
+
+/* total size of a chunk including its header */
+#define CT_RECORD_CHUNK_SIZE(rows, channels) (sizeof(struct ct_record_chunk_header) + \
+    CT_RECORD_ALIGN4((rows) * (4 + (channels) * (2 + 2 + 1) + 1)))
+
+/* column offsets from the start of the chunk header */
+#define CT_RECORD_OFFSET_TIMESTAMP(rows, channels) (sizeof(struct ct_record_chunk_header))
+#define CT_RECORD_OFFSET_COUNT(rows, channels, ch) (CT_RECORD_OFFSET_TIMESTAMP(rows, channels) + (rows) * 4 + (ch) * (rows) * 2)
+#define CT_RECORD_OFFSET_FILTERED(rows, channels, ch) (CT_RECORD_OFFSET_COUNT(rows, channels, channels) + (ch) * (rows) * 2)
+#define CT_RECORD_OFFSET_TRANSFORMED(rows, channels, ch) (CT_RECORD_OFFSET_FILTERED(rows, channels, channels) + (ch) * (rows))
+#define CT_RECORD_OFFSET_MODE(rows, channels) (CT_RECORD_OFFSET_TRANSFORMED(rows, channels, channels))
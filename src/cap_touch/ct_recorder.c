@@ -0,0 +1,299 @@
+/*
+ * File: ct_recorder.c
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Pre-trigger recorder of raw cap touch samples to flash
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "ct_recorder.h"
+#include "ct_record.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "utils/macros_common.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(ct_recorder, LOG_LEVEL_INF);
+
+#define _ROWS (CONFIG_CAP_TOUCH_RECORDER_PRE_SAMPLES + CONFIG_CAP_TOUCH_RECORDER_POST_SAMPLES)
+#define _RECORD_SIZE_MAX (sizeof(struct ct_record_header) + CT_RECORD_CHUNK_SIZE(_ROWS, 1))
+#define _POST_TIMEOUT_MS 2000 // post rows only arrive in _STATE_HIGH_FREQUENCY, the autonomous mode gives none
+#define _PARTITION_ID FIXED_PARTITION_ID(cap_touch_partition)
+#define _SECTORS_MAX 16
+#define _SECTOR_OVERHEAD 32 // FCB sector header, entry length, CRC and alignment
+#define _FCB_MAGIC 0x31434552u // "REC1"
+BUILD_ASSERT(_ROWS <= CT_RECORD_CHUNK_ROWS_MAX, "recorder rows exceed a chunk");
+
+struct _row {
+    uint32_t timestamp_ms;
+    uint16_t count;
+    uint16_t filtered;
+    uint8_t transformed;
+    uint8_t mode;
+};
+
+static const char *const _TRIGGER_NAME[] = {
+    [CT_RECORDER_TRIGGER_MANUAL] = "manual",
+    [CT_RECORDER_TRIGGER_FALSE_WAKE] = "false wake",
+    [CT_RECORDER_TRIGGER_STUCK] = "stuck",
+    [CT_RECORDER_TRIGGER_CHAIN] = "chain stalled",
+};
+
+static bool _ready = false;
+static struct ct_record_header _header;
+static struct flash_sector _sectors[_SECTORS_MAX];
+static struct fcb _fcb;
+static uint16_t _sequence = 0;
+
+/* ring, only accessed from the system work queue */
+static struct _row _ring[_ROWS];
+static uint16_t _ring_idx = 0;
+static uint16_t _ring_fill = 0;
+static int16_t _post_remaining = -1; // -1 when not triggered
+static enum ct_recorder_trigger _trigger;
+static bool _recorded = false;
+static uint32_t _recorded_ms;
+
+static atomic_t _trigger_pending = ATOMIC_INIT(0); // bit per enum ct_recorder_trigger
+static void _trigger_arm(struct k_work *work);
+static K_WORK_DEFINE(_trigger_arm_work, _trigger_arm);
+static void _record_commit(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(_record_commit_work, _record_commit);
+
+/* the record buffer is shared by commit and read */
+static K_MUTEX_DEFINE(_record_lock);
+static uint8_t _record[_RECORD_SIZE_MAX] __aligned(4);
+
+static size_t _record_build(void);
+static int _record_append(size_t size);
+static int _sequence_find(struct fcb_entry_ctx *entry, void *arg);
+
+struct _read_ctx {
+    ct_recorder_read_cb_t cb;
+    void *user_data;
+};
+static int _record_read(struct fcb_entry_ctx *entry, void *arg);
+
+int ct_recorder_init(uint32_t sample_period_us, uint16_t window_ticks_lf, uint16_t window_ticks_hf) {
+    __ASSERT_NO_MSG(!_ready);
+
+    _header = (struct ct_record_header){
+        .magic = CT_RECORD_MAGIC,
+        .version = CT_RECORD_VERSION,
+        .header_size = sizeof(struct ct_record_header),
+        .channels = 1,
+        .columns = CT_RECORD_COLUMN_TIMESTAMP | CT_RECORD_COLUMN_COUNT | CT_RECORD_COLUMN_FILTERED | CT_RECORD_COLUMN_TRANSFORMED | CT_RECORD_COLUMN_MODE,
+        .sample_period_us = sample_period_us,
+        .window_ticks_lf = window_ticks_lf,
+        .window_ticks_hf = window_ticks_hf,
+    };
+
+    uint32_t sector_count = ARRAY_SIZE(_sectors);
+    int err = flash_area_get_sectors(_PARTITION_ID, &sector_count, _sectors);
+    if (err) {
+        LOG_ERR("failed getting recorder partition sectors: %d", err);
+        return err;
+    }
+    if (_RECORD_SIZE_MAX + _SECTOR_OVERHEAD > _sectors[0].fs_size) {
+        LOG_ERR("a record of %zu bytes does not fit a %zu byte sector", _RECORD_SIZE_MAX, _sectors[0].fs_size);
+        return -EFBIG;
+    }
+
+    _fcb = (struct fcb){
+        .f_magic = _FCB_MAGIC,
+        .f_version = CT_RECORD_VERSION,
+        .f_sector_cnt = sector_count,
+        .f_scratch_cnt = 0,
+        .f_sectors = _sectors,
+    };
+    err = fcb_init(_PARTITION_ID, &_fcb);
+    if (err) {
+        LOG_ERR("failed initialising recorder FCB: %d", err);
+        return err;
+    }
+
+    // continue the sequence numbers of the stored records
+    err = fcb_walk(&_fcb, NULL, _sequence_find, NULL);
+    LOG_WRN_IF(err, "failed reading recorder sequence: %d", err);
+    LOG_INF("recorder ready, %d sectors, next record %d", sector_count, _sequence);
+
+    _ready = true;
+    return 0;
+}
+
+void ct_recorder_push(uint16_t count, uint16_t filtered, uint8_t transformed, uint8_t mode) {
+    _ring[_ring_idx] = (struct _row){
+        .timestamp_ms = k_uptime_get_32(),
+        .count = count,
+        .filtered = filtered,
+        .transformed = transformed,
+        .mode = mode,
+    };
+    _ring_idx = (_ring_idx + 1) % _ROWS;
+    if (_ring_fill < _ROWS) _ring_fill++;
+
+    if (_post_remaining > 0 && --_post_remaining == 0) {
+        k_work_reschedule(&_record_commit_work, K_NO_WAIT);
+    }
+}
+
+void ct_recorder_trigger(enum ct_recorder_trigger trigger) {
+    __ASSERT_NO_MSG(trigger < ARRAY_SIZE(_TRIGGER_NAME));
+    atomic_or(&_trigger_pending, BIT(trigger));
+    (void)k_work_submit(&_trigger_arm_work);
+}
+
+int ct_recorder_read(ct_recorder_read_cb_t cb, void *user_data) {
+    __ASSERT_NO_MSG(cb != NULL);
+    if (!_ready) return -ENODEV;
+
+    struct _read_ctx ctx = {.cb = cb, .user_data = user_data};
+    k_mutex_lock(&_record_lock, K_FOREVER);
+    const int err = fcb_walk(&_fcb, NULL, _record_read, &ctx);
+    k_mutex_unlock(&_record_lock);
+    return err;
+}
+
+int ct_recorder_clear(void) {
+    if (!_ready) return -ENODEV;
+
+    k_mutex_lock(&_record_lock, K_FOREVER);
+    const int err = fcb_clear(&_fcb);
+    k_mutex_unlock(&_record_lock);
+    return err;
+}
+
+/* the lowest pending trigger wins, such that a manual trigger is never held off */
+static void _trigger_arm(struct k_work *work) {
+    const atomic_val_t pending = atomic_clear(&_trigger_pending);
+    if (pending == 0 || _post_remaining >= 0) return;
+
+    const enum ct_recorder_trigger trigger = __builtin_ctz(pending);
+    if (trigger != CT_RECORDER_TRIGGER_MANUAL && _recorded && k_uptime_get_32() - _recorded_ms < CONFIG_CAP_TOUCH_RECORDER_HOLDOFF_SEC * MSEC_PER_SEC) {
+        LOG_DBG("trigger %s held off", _TRIGGER_NAME[trigger]);
+        return;
+    }
+
+    LOG_INF("recording on trigger %s", _TRIGGER_NAME[trigger]);
+    _trigger = trigger;
+    _post_remaining = CONFIG_CAP_TOUCH_RECORDER_POST_SAMPLES;
+    k_work_schedule(&_record_commit_work, _post_remaining > 0 ? K_MSEC(_POST_TIMEOUT_MS) : K_NO_WAIT);
+}
+
+static void _record_commit(struct k_work *work) {
+    if (_post_remaining < 0) return;
+    _post_remaining = -1;
+    _recorded = true;
+    _recorded_ms = k_uptime_get_32();
+
+    if (!_ready || _ring_fill == 0) return;
+
+    k_mutex_lock(&_record_lock, K_FOREVER);
+    const size_t size = _record_build();
+    const int err = _record_append(size);
+    k_mutex_unlock(&_record_lock);
+
+    if (err) {
+        LOG_ERR("failed storing record %d: %d", _sequence, err);
+        return;
+    }
+    LOG_INF("stored record %d, %d rows, %zu bytes", _sequence, _ring_fill, size);
+    _sequence++;
+}
+
+/* header and a single chunk of the rows in the ring, oldest first */
+static size_t _record_build(void) {
+    const uint16_t rows = _ring_fill;
+    const size_t size = sizeof(struct ct_record_header) + CT_RECORD_CHUNK_SIZE(rows, 1);
+    memset(_record, 0, size);
+
+    struct ct_record_header *header = (struct ct_record_header*)_record;
+    *header = _header;
+    snprintk(header->description, sizeof(header->description), "trigger %s", _TRIGGER_NAME[_trigger]);
+
+    uint8_t *chunk = _record + sizeof(struct ct_record_header);
+    *(struct ct_record_chunk_header*)chunk = (struct ct_record_chunk_header){
+        .magic = CT_RECORD_CHUNK_MAGIC,
+        .rows = rows,
+        .segment = _sequence,
+        .label = _trigger,
+    };
+
+    uint32_t *timestamp_ms = (uint32_t*)(chunk + CT_RECORD_OFFSET_TIMESTAMP(rows, 1));
+    uint16_t *count = (uint16_t*)(chunk + CT_RECORD_OFFSET_COUNT(rows, 1, 0));
+    uint16_t *filtered = (uint16_t*)(chunk + CT_RECORD_OFFSET_FILTERED(rows, 1, 0));
+    uint8_t *transformed = chunk + CT_RECORD_OFFSET_TRANSFORMED(rows, 1, 0);
+    uint8_t *mode = chunk + CT_RECORD_OFFSET_MODE(rows, 1);
+    const uint16_t oldest = (_ring_idx + _ROWS - rows) % _ROWS;
+    for (uint16_t i = 0; i < rows; i++) {
+        const struct _row *row = &_ring[(oldest + i) % _ROWS];
+        timestamp_ms[i] = row->timestamp_ms;
+        count[i] = row->count;
+        filtered[i] = row->filtered;
+        transformed[i] = row->transformed;
+        mode[i] = row->mode;
+    }
+    return size;
+}
+
+/* when the partition is full, the oldest sector is erased */
+static int _record_append(size_t size) {
+    struct fcb_entry entry;
+    int err = fcb_append(&_fcb, size, &entry);
+    if (err == -ENOSPC) {
+        err = fcb_rotate(&_fcb);
+        if (!err) err = fcb_append(&_fcb, size, &entry);
+    }
+    if (err) return err;
+
+    err = flash_area_write(_fcb.fap, FCB_ENTRY_FA_DATA_OFF(entry), _record, size);
+    if (err) return err;
+    return fcb_append_finish(&_fcb, &entry);
+}
+
+static int _record_read(struct fcb_entry_ctx *entry, void *arg) {
+    const struct _read_ctx *ctx = arg;
+    const uint16_t size = entry->loc.fe_data_len;
+    if (size > sizeof(_record)) {
+        LOG_WRN("skipping record of %d bytes", size);
+        return 0;
+    }
+    const int err = flash_area_read(entry->fap, FCB_ENTRY_FA_DATA_OFF(entry->loc), _record, size);
+    if (err) return err;
+    return ctx->cb(_record, size, ctx->user_data);
+}
+
+static int _sequence_find(struct fcb_entry_ctx *entry, void *arg) {
+    struct ct_record_chunk_header chunk;
+    const int err = flash_area_read(entry->fap, FCB_ENTRY_FA_DATA_OFF(entry->loc) + sizeof(struct ct_record_header), &chunk, sizeof(chunk));
+    if (!err && chunk.magic == CT_RECORD_CHUNK_MAGIC) {
+        _sequence = chunk.segment + 1; // walked oldest first
+    }
+    return 0;
+}
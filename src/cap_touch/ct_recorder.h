@@ -0,0 +1,66 @@
+/*
+ * File: ct_recorder.h
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Pre-trigger recorder of raw cap touch samples to flash
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Keeps the last CONFIG_CAP_TOUCH_RECORDER_PRE_SAMPLES rows of the driver in a RAM ring. On a trigger, CONFIG_CAP_TOUCH_RECORDER_POST_SAMPLES more rows
+ * are collected, or as many as arrive within _POST_TIMEOUT_MS, and the ring is committed to the cap_touch_partition flash partition as one record.
+ * 
+ * A record is a complete file of the ct_record.h format: a header and a single chunk, with the trigger as chunk label and a sequence number,
+ * continued over reboots, as segment. Records are appended to a flash circular buffer (FCB), which erases the oldest sector when full, such that wear is spread over
+ * the partition. A row with count 0 marks the return to the autonomous low frequency mode, which has no sample of its own.
+ * 
+ * Rows are pushed from the system work queue, the flash write is done there as well. Automatic triggers are ignored for
+ * CONFIG_CAP_TOUCH_RECORDER_HOLDOFF_SEC after a record, such that a repeating event does not wear the flash.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum ct_recorder_trigger {
+    CT_RECORDER_TRIGGER_MANUAL = 0,
+    CT_RECORDER_TRIGGER_FALSE_WAKE, // woken from the autonomous mode, but no HF sample above level 0
+    CT_RECORDER_TRIGGER_STUCK,
+    CT_RECORDER_TRIGGER_CHAIN,      // measurement chain stalled
+};
+
+/* called for each record, data is a complete ct_record.h file which is only valid during the call. Return non-zero to stop */
+typedef int (*ct_recorder_read_cb_t)(const uint8_t *data, size_t size, void *user_data);
+
+int ct_recorder_init(uint32_t sample_period_us, uint16_t window_ticks_lf, uint16_t window_ticks_hf);
+
+/* mode is enum ct_record_mode */
+void ct_recorder_push(uint16_t count, uint16_t filtered, uint8_t transformed, uint8_t mode);
+
+/* can be called from any thread */
+void ct_recorder_trigger(enum ct_recorder_trigger trigger);
+
+/* oldest record first */
+int ct_recorder_read(ct_recorder_read_cb_t cb, void *user_data);
+
+int ct_recorder_clear(void);
@@ -0,0 +1,134 @@
+/*
+ * File: ct_scan.h
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Activity based scan schedule for many electrodes
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** A single COMP is multiplexed over the pads by PSEL, and each RTC period of ct_current_oscillate.c is one sample window, a slot.
+ * ct_scan_next() gives the pad and mode of the next slot:
+ * - idle pads share LF slots round robin, each held for lf_dwell slots. The CPU only writes PSEL when rotating, and the autonomous PPI path runs in between
+ * - active pads, touched within the last hold scans or neighbour of such a pad, get HF slots round robin. One slot in idle_every still goes to an idle pad,
+ *   such that a touch on an idle pad is detected while another pad is active
+ * 
+ * Slots are spread evenly by the RTC period instead of scanning all active pads back to back, and the comparator on time is one window per slot.
+ * With no activity, this is one LF window per period independent of the number of pads, and it grows with the number of active pads only.
+ * PSEL is a register without a task, so the pad switch itself can not be done through PPI.
+ * 
+ * Both functions are bounded by one pass over the pads. The header only depends on the C standard library, such that it can run on host.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CT_SCAN_PADS_MAX 8
+
+enum ct_scan_mode {
+    CT_SCAN_MODE_LF,
+    CT_SCAN_MODE_HF,
+};
+
+struct ct_scan_slot {
+    uint8_t pad;
+    uint8_t mode;   // enum ct_scan_mode
+};
+
+struct ct_scan {
+    /* configuration */
+    uint8_t pads;           // 1 to CT_SCAN_PADS_MAX
+    bool wheel;             // first and last pad are neighbours
+    uint8_t hold;           // HF scans at level 0 before an active pad is idle again
+    uint8_t idle_every;     // one slot in idle_every is an LF slot while pads are active
+    uint8_t lf_dwell;       // consecutive LF slots on the same idle pad
+
+    /* internal */
+    uint8_t activity[CT_SCAN_PADS_MAX]; // remaining hold, 0 is idle
+    uint8_t slot;
+    uint8_t dwell;
+    uint8_t next_active;
+    uint8_t next_idle;
+    uint8_t idle;           // idle pad of the current dwell
+};
+
+#define CT_SCAN_INIT(_pads, _wheel) { \
+    .pads = (_pads), \
+    .wheel = (_wheel), \
+    .hold = 8, \
+    .idle_every = 4, \
+    .lf_dwell = 4, \
+}
+
+static inline void _ct_scan_activate(struct ct_scan *s, int32_t pad) {
+    if (s->wheel) pad = (pad + s->pads) % s->pads;
+    if (pad < 0 || pad >= s->pads) return;
+    s->activity[pad] = s->hold;
+}
+
+/* result of a slot, level from ct_transform(). LF slots only report touch with a level above 0 */
+static inline void ct_scan_update(struct ct_scan *s, uint8_t pad, uint8_t level) {
+    if (pad >= s->pads) return;
+    if (level > 0) {
+        _ct_scan_activate(s, pad - 1);
+        _ct_scan_activate(s, pad);
+        _ct_scan_activate(s, pad + 1);
+    } else if (s->activity[pad] > 0) {
+        s->activity[pad]--;
+    }
+}
+
+/* first pad from start, round robin, with the given activity state. Returns pads if none */
+static inline uint8_t _ct_scan_find(const struct ct_scan *s, uint8_t start, bool active) {
+    for (uint8_t i = 0; i < s->pads && i < CT_SCAN_PADS_MAX; i++) {
+        const uint8_t pad = (start + i) % s->pads;
+        if ((s->activity[pad] > 0) == active) return pad;
+    }
+    return s->pads;
+}
+
+static inline struct ct_scan_slot ct_scan_next(struct ct_scan *s) {
+    const uint8_t active = _ct_scan_find(s, s->next_active, true);
+    s->slot = (s->slot + 1) % (s->idle_every ? s->idle_every : 1);
+
+    if (active < s->pads && s->slot != 0) {
+        s->next_active = (active + 1) % s->pads;
+        return (struct ct_scan_slot){ .pad = active, .mode = CT_SCAN_MODE_HF };
+    }
+
+    // stay on the idle pad for lf_dwell slots, unless it became active
+    if (s->dwell == 0 || s->activity[s->idle] > 0) {
+        const uint8_t idle = _ct_scan_find(s, s->next_idle, false);
+        if (idle == s->pads) {
+            // all pads active
+            s->next_active = (active + 1) % s->pads;
+            return (struct ct_scan_slot){ .pad = active, .mode = CT_SCAN_MODE_HF };
+        }
+        s->idle = idle;
+        s->next_idle = (idle + 1) % s->pads;
+        s->dwell = s->lf_dwell ? s->lf_dwell : 1;
+    }
+    s->dwell--;
+    return (struct ct_scan_slot){ .pad = s->idle, .mode = CT_SCAN_MODE_LF };
+}
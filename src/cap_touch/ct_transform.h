@@ -0,0 +1,89 @@
+/*
+ * File: ct_transform.h
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Mapping from oscillation count to touch level
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** Counts are inversely proportional to capacitance. A calibration point (count with no touch) gives the counter region:
+ * - activate: below this count, the autonomous mode wakes the CPU and the output level is above 0
+ * - saturate: below this count, the output level is at its maximum of 127
+ * 
+ * Both are given in low frequency window counts. ct_transform() scales them to the high frequency window.
+ * The header only depends on the C standard library, such that the same mapping can run on host.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define CT_FIXED8_PERCENT(percent) ((percent) * (255) / 100)
+
+#ifndef CT_ACTIVATE_MARGIN_DEFAULT
+#define CT_ACTIVATE_MARGIN_DEFAULT CT_FIXED8_PERCENT(80)
+#endif
+#ifndef CT_SATURATE_MARGIN_DEFAULT
+#define CT_SATURATE_MARGIN_DEFAULT CT_FIXED8_PERCENT(40)
+#endif
+
+struct ct_counter_region {
+    uint32_t nominal;
+    uint32_t activate;
+    uint32_t saturate;
+};
+
+static inline struct ct_counter_region ct_counter_region_calc(uint32_t calibration_point, uint8_t activate_margin, uint8_t saturate_margin) {
+    uint32_t activate = (calibration_point * activate_margin) >> 8;
+    uint32_t saturate = (calibration_point * saturate_margin) >> 8;
+
+    // minimum value which assures no conflict
+    if (activate < 2) {
+        activate = 3;
+    }
+    if (saturate >= activate) {
+        saturate = activate - 1;
+    }
+
+    return (struct ct_counter_region){
+        .nominal = calibration_point,
+        .activate = activate,
+        .saturate = saturate,
+    };
+}
+
+/* map a high frequency value, with frac_bits of extra resolution, to something approximately proportional with capacitance, in the range 0 to 127. Returns -1 if the region is invalid */
+static inline int32_t ct_transform(uint16_t value, const struct ct_counter_region *region, uint32_t ticks_lf, uint32_t ticks_hf, uint8_t frac_bits) {
+    // TODO: precalculate constants
+    static const int32_t a = CT_FIXED8_PERCENT(50);
+    const int32_t A = (region->nominal * ticks_hf * a / ticks_lf >> 8) << frac_bits;
+    const int32_t Sp = region->activate * ticks_hf / ticks_lf << frac_bits;
+    const int32_t Sn = region->saturate * ticks_hf / ticks_lf << frac_bits;
+    const int32_t value_clamp = value < (uint16_t)Sn ? (uint16_t)Sn : value > (uint16_t)Sp ? (uint16_t)Sp : value;
+
+    const int32_t denominator = (Sp - Sn)*(value_clamp + A - Sn);
+    if (denominator == 0) {
+        return -1;
+    }
+    return 127*A*(Sp - value_clamp)/denominator;
+}
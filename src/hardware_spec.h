@@ -37,6 +37,13 @@
 #define LED_PIN 25
 #define LED_POLARITY 1
 
-// which pin the cap electride is connected to
+// which pin the cap electride is connected to. With CONFIG_CAP_TOUCH_DRIVER, the devicetree node is used instead
 #define CAPTOUCH_PSEL_COMP COMP_PSEL_PSEL_AnalogInput7
-#define CAPTOUCH_PSEL_PIN 31
\ No newline at end of file
+#define CAPTOUCH_PSEL_PIN 31
+
+// shielded reference electrode or dummy pad with CONFIG_CAP_TOUCH_DIFFERENTIAL
+#define CAPTOUCH_PSEL_REFERENCE COMP_PSEL_PSEL_AnalogInput5
+
+// touch output pin with CONFIG_CAP_TOUCH_OUTPUT_PIN, active high
+#define CAPTOUCH_OUTPUT_PIN 30
+#define CAPTOUCH_OUTPUT_POLARITY 1
\ No newline at end of file
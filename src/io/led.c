@@ -28,13 +28,36 @@
 
 #include <zephyr/kernel.h>
 
+/** With CONFIG_LED_PWM, the LED is driven by PWM0 at 1kHz. A blink is sequence 0, full brightness followed by off, each held for _BLINK_MS,
+ * and the SEQEND0_STOP shortcut stops the PWM after it. Starting it is a single task, such that it can be triggered through PPI by other peripherals.
+ * A brightness level is sequence 1 with a single value, which the PWM keeps generating after the sequence ends until stopped.
+ * The pin goes to its GPIO OUT state when the PWM is stopped, which is kept at off.
+*/
+
+#define _BLINK_MS 20
+
+#if CONFIG_LED_PWM
+#define PWM_SELECT NRF_PWM0
+#define _PWM_COUNTERTOP 1000 // 1kHz at 1MHz
+#define _PWM_POLARITY_FALLING_EDGE 0x8000 // output starts high and falls at the compare value, otherwise it starts low
+
+static uint16_t _pwm_seq_blink[2];
+static uint16_t _pwm_seq_level[1];
+static uint8_t _level = 0;
+
+static void _configure_pwm(void);
+static uint16_t _pwm_value(uint16_t duty);
+#endif
+
 static volatile NRF_GPIO_Type* _port;
 static uint32_t _pin;
 static int _polarity;
 
 static void _led_set_state(int state);
+#if !CONFIG_LED_PWM
 static void _blink_done(struct k_work *);
 static K_WORK_DELAYABLE_DEFINE(_blink_done_work, _blink_done);
+#endif
 
 void led_init(uint32_t pin, volatile NRF_GPIO_Type* port, int polarity) {
     __ASSERT_NO_MSG(port != NULL);
@@ -48,16 +71,78 @@ void led_init(uint32_t pin, volatile NRF_GPIO_Type* port, int polarity) {
     _led_set_state(0);
 
     _port->DIRSET = 1 << _pin;
+#if CONFIG_LED_PWM
+    _configure_pwm();
+#endif
 }
 
 void led_blink(void) {
+#if CONFIG_LED_PWM
+    if (_level == 0) {
+        PWM_SELECT->TASKS_SEQSTART[0] = 1;
+    }
+#else
     _led_set_state(1);
-    k_work_reschedule(&_blink_done_work, K_MSEC(20));
+    k_work_reschedule(&_blink_done_work, K_MSEC(_BLINK_MS));
+#endif
+}
+
+void led_level_set(uint8_t level) {
+#if CONFIG_LED_PWM
+    __ASSERT_NO_MSG(level <= 127);
+    _level = level;
+    if (level == 0) {
+        PWM_SELECT->TASKS_STOP = 1;
+        return;
+    }
+    _pwm_seq_level[0] = _pwm_value(level * _PWM_COUNTERTOP / 127);
+    PWM_SELECT->TASKS_SEQSTART[1] = 1;
+#else
+    k_work_cancel_delayable(&_blink_done_work);
+    _led_set_state(level > 0);
+#endif
+}
+
+#if CONFIG_LED_PWM
+volatile uint32_t* led_blink_task_get(void) {
+    return &PWM_SELECT->TASKS_SEQSTART[0];
+}
+
+static void _configure_pwm(void) {
+    _pwm_seq_blink[0] = _pwm_value(_PWM_COUNTERTOP);
+    _pwm_seq_blink[1] = _pwm_value(0);
+
+    PWM_SELECT->PSEL.OUT[0] = _pin;
+    PWM_SELECT->MODE = PWM_MODE_UPDOWN_Up << PWM_MODE_UPDOWN_Pos;
+    PWM_SELECT->PRESCALER = PWM_PRESCALER_PRESCALER_DIV_16 << PWM_PRESCALER_PRESCALER_Pos;
+    PWM_SELECT->COUNTERTOP = _PWM_COUNTERTOP;
+    PWM_SELECT->DECODER = (PWM_DECODER_LOAD_Common << PWM_DECODER_LOAD_Pos) | (PWM_DECODER_MODE_RefreshCount << PWM_DECODER_MODE_Pos);
+    PWM_SELECT->LOOP = 0;
+
+    PWM_SELECT->SEQ[0].PTR = (uint32_t)_pwm_seq_blink;
+    PWM_SELECT->SEQ[0].CNT = ARRAY_SIZE(_pwm_seq_blink);
+    PWM_SELECT->SEQ[0].REFRESH = _BLINK_MS - 1; // each value is played REFRESH + 1 periods
+    PWM_SELECT->SEQ[0].ENDDELAY = 0;
+    PWM_SELECT->SEQ[1].PTR = (uint32_t)_pwm_seq_level;
+    PWM_SELECT->SEQ[1].CNT = ARRAY_SIZE(_pwm_seq_level);
+    PWM_SELECT->SEQ[1].REFRESH = 0;
+    PWM_SELECT->SEQ[1].ENDDELAY = 0;
+
+    PWM_SELECT->SHORTS = PWM_SHORTS_SEQEND0_STOP_Msk;
+    PWM_SELECT->ENABLE = PWM_ENABLE_ENABLE_Enabled << PWM_ENABLE_ENABLE_Pos;
+}
+
+/* duty in PWM counts, active for duty counts of the period regardless of LED polarity */
+static uint16_t _pwm_value(uint16_t duty) {
+    return _polarity ? duty | _PWM_POLARITY_FALLING_EDGE : duty;
 }
+#endif
 
+#if !CONFIG_LED_PWM
 static void _blink_done(struct k_work *work) {
     _led_set_state(0);
 }
+#endif
 
 static void _led_set_state(int state) {
     if (state ^ _polarity) {
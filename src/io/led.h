@@ -33,4 +33,12 @@
 void led_init(uint32_t pin, volatile NRF_GPIO_Type* port, int polarity);
 void led_blink(void);
 
+/* brightness from 0 (off) to 127 */
+void led_level_set(uint8_t level);
+
+#if CONFIG_LED_PWM
+/* task starting a blink, to be triggered through PPI */
+volatile uint32_t* led_blink_task_get(void);
+#endif
+
 #endif
\ No newline at end of file
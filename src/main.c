@@ -29,6 +29,14 @@
 #include "hardware_spec.h"
 #include "cap_touch/cap_touch.h"
 #include "io/led.h"
+#include "utils/macros_common.h"
+#if CONFIG_CAP_TOUCH_RECORDER
+#include "cap_touch/ct_recorder.h"
+#endif
+#if CONFIG_CAP_TOUCH_DRIVER
+#include <zephyr/input/input.h>
+#include <zephyr/pm/device_runtime.h>
+#endif
 
 #if CONFIG_DEBUG
 #include "bluetooth/bt_connection_manager.h"
@@ -39,6 +47,17 @@ static void _bt_event(enum bt_connection_state);
 LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 
 static void _cap_touch_event(uint8_t value);
+#if CONFIG_CAP_TOUCH_DRIVER
+#define CAP_TOUCH_DEVICE DEVICE_DT_GET_ONE(bentdal_cap_touch_comp)
+static void _cap_touch_input(struct input_event *evt);
+INPUT_CALLBACK_DEFINE(CAP_TOUCH_DEVICE, _cap_touch_input);
+#endif
+#if CONFIG_CAP_TOUCH_PROXIMITY
+static void _cap_touch_approach(void);
+#endif
+#if CONFIG_DEBUG && CONFIG_CAP_TOUCH_RECORDER
+static int _cap_touch_record_print(const uint8_t *data, size_t size, void *user_data);
+#endif
 
 int main(void) {
     /* simple blinking to indicate whether the system is working or not */
@@ -49,9 +68,36 @@ int main(void) {
     bt_connection_init(_bt_event);
 #endif
 
+#if !CONFIG_CAP_TOUCH_DRIVER
+    /* with the driver, the electrode, reference and output pin are initialised from the devicetree */
     cap_touch_init(_cap_touch_event, CAPTOUCH_PSEL_COMP, CAPTOUCH_PSEL_PIN);
+#endif
+#if CONFIG_CAP_TOUCH_PROXIMITY
+    cap_touch_approach_init(_cap_touch_approach);
+#endif
+#if CONFIG_CAP_TOUCH_DIFFERENTIAL && !CONFIG_CAP_TOUCH_DRIVER
+    cap_touch_reference_init(CAPTOUCH_PSEL_REFERENCE);
+#endif
+#if CONFIG_DEBUG && CONFIG_CAP_TOUCH_RECORDER
+    /* stored records go to the log backend, UART, RTT or BLE */
+    int err = ct_recorder_read(_cap_touch_record_print, NULL);
+    LOG_WRN_IF(err, "failed reading cap touch records: %d", err);
+#endif
+#if CONFIG_CAP_TOUCH_OUTPUT_PIN && !CONFIG_CAP_TOUCH_DRIVER
+    cap_touch_output_init(CAPTOUCH_OUTPUT_PIN, CAPTOUCH_OUTPUT_POLARITY);
+#endif
+#if CONFIG_LED_PWM
+    /* flash on touch from the PPI chain, brightness follows the touch level in _cap_touch_event */
+    cap_touch_detect_task_connect(led_blink_task_get());
+#endif
 
+#if CONFIG_CAP_TOUCH_DRIVER
+    /* runs while referenced, released with pm_device_runtime_put_async() */
+    int pm_err = pm_device_runtime_get(CAP_TOUCH_DEVICE);
+    LOG_WRN_IF(pm_err, "failed starting cap touch: %d", pm_err);
+#else
     cap_touch_start();
+#endif
     led_blink();
 
     while(true) {
@@ -69,5 +115,31 @@ static void _bt_event(enum bt_connection_state) {
 #endif
 
 static void _cap_touch_event(uint8_t value) {
+#if CONFIG_LED_PWM
+    led_level_set(value);
+#else
+    led_blink();
+#endif
+}
+
+#if CONFIG_CAP_TOUCH_DRIVER
+static void _cap_touch_input(struct input_event *evt) {
+    if (evt->type == INPUT_EV_ABS && evt->code == INPUT_ABS_Z) {
+        _cap_touch_event(evt->value);
+    }
+}
+#endif
+
+#if CONFIG_CAP_TOUCH_PROXIMITY
+static void _cap_touch_approach(void) {
     led_blink();
-}
\ No newline at end of file
+}
+#endif
+
+#if CONFIG_DEBUG && CONFIG_CAP_TOUCH_RECORDER
+/* each record is a complete .ctr file, see src/cap_touch/ct_record.h */
+static int _cap_touch_record_print(const uint8_t *data, size_t size, void *user_data) {
+    LOG_HEXDUMP_INF(data, size, "cap touch record");
+    return 0;
+}
+#endif
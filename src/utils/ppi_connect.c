@@ -54,7 +54,9 @@ uint32_t ppi_new_group_find(void) {
 uint32_t ppi_connect(volatile uint32_t* eep, volatile uint32_t* tep) {
     static uint32_t internal_used_channels = 0;
     uint32_t ppi_index = 0;
-    while ((NRF_PPI->CHEN & (1U << ppi_index)) && ((internal_used_channels & (1U << ppi_index))) && (NRF_PPI->CH[ppi_index].EEP != (uint32_t)NULL || NRF_PPI->CH[ppi_index].TEP != (uint32_t)NULL)) {
+    // channels handed out before are used even while disabled, channels enabled or configured by others are skipped as well
+    while ((internal_used_channels & (1U << ppi_index)) || (NRF_PPI->CHEN & (1U << ppi_index)) ||
+           NRF_PPI->CH[ppi_index].EEP != (uint32_t)NULL || NRF_PPI->CH[ppi_index].TEP != (uint32_t)NULL) {
         ppi_index++;
         __ASSERT(ppi_index < NUM_PPI_CHANNELS, "No available PPI channel");
     }
@@ -0,0 +1,60 @@
+/*
+ * File: ram_power.c
+ * Author: Rein Gundersen Bentdal
+ * Created: 18.Okt 2026
+ * Description: Power down of the RAM sections above the image in System ON
+ *
+ * Copyright (c) 2026, Rein Gundersen Bentdal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/linker/linker-defs.h>
+#include <zephyr/sys/util.h>
+#include "nrf.h"
+
+#if CONFIG_COMMON_LIBC_MALLOC_ARENA_SIZE < 0
+#error "CONFIG_RAM_POWER_DOWN_UNUSED needs a fixed size malloc arena, the arena uses all RAM above the image"
+#endif
+
+/* nRF52832: RAM[n] is two 4 KB sections, S0 and S1 */
+#define _RAM_SECTION_SIZE 0x1000
+#define _RAM_SECTIONS_PER_BLOCK 2
+
+#define _RAM_START DT_REG_ADDR(DT_CHOSEN(zephyr_sram))
+#define _RAM_END (DT_REG_ADDR(DT_CHOSEN(zephyr_sram)) + DT_REG_SIZE(DT_CHOSEN(zephyr_sram)))
+
+/* The stacks and the heap are part of the image, so everything above _image_ram_end is unused.
+ * Sections are off in System ON, and retention is only used in System OFF, so both are cleared. */
+static int _ram_power_down_unused(void) {
+    uintptr_t section = ROUND_UP((uintptr_t)_image_ram_end, _RAM_SECTION_SIZE);
+
+    for (; section < _RAM_END; section += _RAM_SECTION_SIZE) {
+        uint32_t index = (section - _RAM_START) / _RAM_SECTION_SIZE;
+        uint32_t block = index / _RAM_SECTIONS_PER_BLOCK;
+        uint32_t s = index % _RAM_SECTIONS_PER_BLOCK;
+        NRF_POWER->RAM[block].POWERCLR = (POWER_RAM_POWERCLR_S0POWER_Msk | POWER_RAM_POWERCLR_S0RETENTION_Msk) << s;
+    }
+    return 0;
+}
+
+SYS_INIT(_ram_power_down_unused, PRE_KERNEL_1, 0);